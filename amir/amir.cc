@@ -3,8 +3,31 @@
 #include <array>
 #include <vector>
 #include <bitset>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <numeric>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <sys/resource.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/program_options.hpp>
 #include <boost/cstdint.hpp>
+#include "combination.h"
+#include "kernel.h"
+#include "symmetry.h"
+#include "cover.h"
+#include "set_file.h"
+#include "exact.h"
+
+namespace bpo = boost::program_options;
 
 /*
 
@@ -24,111 +47,1654 @@ can it go?
 
 Combinations are represented as bit-permutations of
 numbers having popcount of 6 in a 49-bit wide field
-of an Int64.
+of an Int64. See combination.h.
+
+The search works for other lotteries too: choose K out of
+N and guarantee T matches. N, K and T are template
+parameters, so the inner loops are compiled for each
+lottery separately.
 
 This code demostrates cool i/o ability of std::bitset.
 
 */
 
-const int num_combinations = 13983816;
-typedef uint64_t Combination;
-typedef std::array<Combination, num_combinations> All_combinations;
-typedef std::vector<Combination> Amir_set;
+template<typename L>
+void add_to_amir_set(Amir_set<L>& amir, typename L::Combination p)
+{
+  bool not_in_amir = true;
+  for (auto a : amir)
+    if (equivalent<L>(a, p)) {
+      not_in_amir = false;
+      break;
+    }
+  if (not_in_amir)
+    amir.push_back(p);
+}
+
+/*
+
+Subset index.
+
+Two combinations are equivalent exactly when they share
+T numbers. So instead of comparing a candidate with every
+member of the Amir set, we keep a bitmap of the T-subsets
+covered by the members. For the Amir problem these are the
+C(49,3) = 18424 triples, and a candidate is tested by
+probing its 20 triples, no matter how big the Amir set has
+grown.
+
+T-subsets {a < b < c ...} are ranked in colex order:
+
+  rank = C(a,1) + C(b,2) + C(c,3) + ...
+
+Which T of the K positions of a candidate make up each
+subset is worked out at compile time.
 
-int binomial(int n, int k)
+*/
+
+template<int K, int T> struct Subset_table
 {
-  if (n == k) return 1;
-  if (k > n - k) k = n - k;
-  int result = 1;
-  for (int i = 1; i <= k; i++) {
-      result *= n;
-      result /= i;
-      n--;
+  static constexpr int size = binomial(K, T);
+  constexpr Subset_table() : index{}
+  {
+    int row = 0;
+    for (int s = (1 << T) - 1; s < (1 << K); s = next_combination(uint64_t(s))) {
+      int j = 0;
+      for (int i = 0; i < K; ++i)
+        if (s & (1 << i))
+          index[row][j++] = i;
+      ++row;
+    }
   }
-  return result;
+  int index[size][T];
+};
+
+template<int K, int T> constexpr Subset_table<K, T> subsets{};
+
+template<typename L> class Subset_index
+{
+public:
+  typedef typename L::Combination Combination;
+  bool covers(Combination p) const;
+  // Same, counting the T-subsets it looked at.
+  bool covers(Combination p, int& probes) const;
+  void insert(Combination p);
+private:
+  template<typename F> bool any_subset(Combination p, F f) const;
+  std::bitset<binomial(L::N, L::T)> covered;
+};
+
+// Calls f with the rank of each T-subset of p until f
+// returns true. The K bit positions come out of p in
+// increasing order.
+template<typename L> template<typename F>
+bool Subset_index<L>::any_subset(Combination p, F f) const
+{
+  std::array<int, L::K> x;
+  for (int i = 0; i < L::K; ++i) {
+    x[i] = lowest_bit(p);
+    p &= p - 1;
+  }
+  for (auto& row : subsets<L::K, L::T>.index) {
+    uint64_t rank = 0;
+    for (int i = 0; i < L::T; ++i)
+      rank += binomials<L::N, L::K>.column[i + 1][x[row[i]]];
+    if (f(rank))
+      return true;
+  }
+  return false;
+}
+
+template<typename L> bool Subset_index<L>::covers(Combination p) const
+{
+  return any_subset(p, [&](uint64_t t) { return covered[t]; });
+}
+
+template<typename L> bool Subset_index<L>::covers(Combination p, int& probes) const
+{
+  probes = 0;
+  return any_subset(p, [&](uint64_t t) { ++probes; return covered[t]; });
 }
 
-All_combinations make_all_combinations()
+template<typename L> void Subset_index<L>::insert(Combination p)
 {
-  All_combinations result;
-  Combination a = 63;
-  Combination c, r;
-  for (int i = 0; i < num_combinations; i++) {
-    result[i] = a;
-    c = a & -a;
-    r = a + c;
-    a = (((r ^ a) >> 2) / c) | r;
+  any_subset(p, [&](uint64_t t) { covered.set(t); return false; });
+}
+
+/*
+
+Engines.
+
+An engine decides whether a candidate joins the Amir set.
+The scan engine is the original loop over all members.
+The triple engine asks the subset index instead, and the
+simd engine runs the batched kernels of kernel.h.
+
+*/
+
+template<typename L> struct Scan_engine
+{
+  Amir_set<L> amir;
+  void add(typename L::Combination p) { add_to_amir_set<L>(amir, p); }
+};
+
+template<typename L> struct Triple_engine
+{
+  Amir_set<L> amir;
+  Subset_index<L> index;
+  void add(typename L::Combination p)
+  {
+    if (!index.covers(p)) {
+      amir.push_back(p);
+      index.insert(p);
+    }
   }
-  return result;
+};
+
+template<typename L> struct Simd_engine
+{
+  typedef typename L::Combination Combination;
+  Simd_engine(const std::string& isa) : kernel{Kernels<L>::equivalence(isa)} {}
+  Amir_set<L> amir;
+  Member_array<Combination> members;
+  Batch_kernel<Combination> kernel;
+  void add(Combination p)
+  {
+    if (!kernel(members.begin(), members.padded_size(), p)) {
+      amir.push_back(p);
+      members.push_back(p);
+    }
+  }
+};
+
+// The seed of the original 6 of 49 search, K bits starting
+// at bit 18, or as high as they fit.
+template<typename L> typename L::Combination seed_combination()
+{
+  return low_bits<typename L::Combination>(L::K) << std::min(18, L::N - L::K);
 }
 
-// A cross between reversing bits and mirror-image of bits.
-Combination mirror_combination(Combination x, int width)
+/*
+
+Checkpoints.
+
+With --checkpoint-every the sweeps save their state, the
+set so far and the number of colex ranks looked at, to the
+--state file in the binary format of set_file.h. --resume
+reads it back: the members are replayed into the engine,
+which takes them all since no two are equivalent, and the
+sweep goes on from the saved rank. Looking at a rank twice
+changes nothing, so the result is the set an uninterrupted
+sweep with the same options finds.
+
+*/
+
+const uint64_t checkpoint_stride = 1 << 16;
+
+template<typename L> class Checkpointer
+{
+public:
+  Checkpointer(const std::string& filename, double seconds)
+    : filename{filename}, interval{seconds},
+      last{boost::posix_time::microsec_clock::local_time()} {}
+  // Saves if the interval has passed since the last save.
+  void operator()(const Amir_set<L>& amir, uint64_t position)
+  {
+    if (interval <= 0)
+      return;
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+    if ((now - last).total_milliseconds() < 1000 * interval)
+      return;
+    write_binary_set<L>(filename, amir, position);
+    last = now;
+    saves++;
+  }
+  long saves{0};
+private:
+  std::string filename;
+  double interval;
+  boost::posix_time::ptime last;
+};
+
+// Add combinations and their images under the symmetry
+// group to the amir set. With the mirror group these are
+// the combination and its mirror, as in the original search.
+template<typename L, typename Engine>
+Amir_set<L> greedy_sweep(Engine& engine, const Symmetry_group<L>& group,
+                         const Sweep_state<L>& from, Checkpointer<L>& checkpoint)
+{
+  auto add = [&](typename L::Combination p) { engine.add(p); };
+  if (from.amir.empty())
+    group.orbit(seed_combination<L>(), add);
+  for (auto p : from.amir)
+    engine.add(p);
+
+  // First combination is 0b111111 (K ones).
+  Colex_range<L> range(from.position, L::num_combinations);
+  for (auto it = range.begin(); it != range.end(); ++it) {
+    if (it.index() % checkpoint_stride == 0)
+      checkpoint(engine.amir, it.index());
+    group.orbit(*it, add);
+  }
+  return engine.amir;
+}
+
+/*
+
+Orbit sweep.
+
+Looks for a G-invariant Amir set, a union of whole orbits
+of the symmetry group G. A combination is covered by such a
+set exactly when every image of it is, so only one member of
+each orbit needs a coverage check: the canonical one, the
+smallest mask. When it is uncovered its whole orbit is added
+at once.
+
+If G contains all rotations, the smallest mask of an orbit
+has bit 0 set (otherwise rotating it down would give a
+smaller one), so only the C(N-1, K-1) combinations through
+label 0 are visited. The work drops by roughly the order of
+the group.
+
+*/
+
+struct Orbit_stats
 {
-  Combination b{0};
-  int i = 0;
-  while (i < width) {
-    b <<= 1;
-    b |= (x & 1);
-    x >>= 1;
-    i += 1;
+  long visited{0};
+  long representatives{0};
+  long orbits{0};
+};
+
+template<typename L>
+Amir_set<L> orbit_sweep(const Symmetry_group<L>& group, Orbit_stats& stats)
+{
+  typedef typename L::Combination Combination;
+  Subset_index<L> index;
+  Amir_set<L> amir;
+
+  auto visit = [&](Combination x) {
+    stats.visited++;
+    if (!group.is_canonical(x))
+      return;
+    stats.representatives++;
+    if (index.covers(x))
+      return;
+    stats.orbits++;
+    Amir_set<L> orbit;
+    group.orbit(x, [&](Combination p) { orbit.push_back(p); });
+    std::sort(orbit.begin(), orbit.end());
+    orbit.erase(std::unique(orbit.begin(), orbit.end()), orbit.end());
+    for (auto p : orbit) {
+      amir.push_back(p);
+      index.insert(p);
+    }
+  };
+
+  if (group.has_rotations()) {
+    for (Combination a = low_bits<Combination>(L::K - 1);
+         (a >> (L::N - 1)) == 0; a = next_combination(a))
+      visit((a << 1) | 1);
+  } else {
+    for (auto a : Colex_range<L>(0, L::num_combinations))
+      visit(a);
   }
-  return b;
+  return amir;
 }
 
-// Combinations are equivalent if they have more than
-// two bits in common. We use an unrolled variation of
-// Kernighan's popcount algorithm. We cut it short since
-// we don't need the full popcount.
-bool equivalent(Combination a, Combination b)
+/*
+
+Parallel sweep.
+
+The colex range is cut into chunks. In each round the worker
+threads filter a batch of chunks against a snapshot of the
+subset index taken at the start of the round. The Amir set
+only grows, so a candidate covered by the snapshot can never
+join it. The survivors are then merged serially, in sweep
+order, against the live index. This gives exactly the set
+the sequential sweep finds.
+
+*/
+
+const uint64_t chunk_size = 1 << 16;
+
+template<typename L> uint64_t num_chunks()
 {
-  Combination n{a & b};
-  n = n & (n - 1);
-  n = n & (n - 1);
-  return n > 0;
+  return (L::num_combinations + chunk_size - 1) / chunk_size;
 }
 
-void add_to_amir_set(Amir_set& amir, Combination p)
+template<typename L> Colex_range<L> chunk(uint64_t k)
 {
-  bool not_in_amir = true;
+  return Colex_range<L>(k * chunk_size, std::min(L::num_combinations, (k + 1) * chunk_size));
+}
+
+struct Thread_stats
+{
+  long candidates{0};
+  long survivors{0};
+  double seconds{0};
+};
+
+template<typename L>
+Amir_set<L> parallel_sweep(int num_threads, const Symmetry_group<L>& group,
+                           const Sweep_state<L>& from, Checkpointer<L>& checkpoint,
+                           std::vector<Thread_stats>& stats)
+{
+  typedef typename L::Combination Combination;
+  Triple_engine<L> engine;
+  if (from.amir.empty())
+    group.orbit(seed_combination<L>(), [&](Combination p) { engine.add(p); });
+  for (auto p : from.amir)
+    engine.add(p);
+
+  uint64_t batch = 4 * num_threads;
+  std::vector<std::vector<Combination>> survivors(batch);
+  stats.assign(num_threads, Thread_stats());
+
+  for (uint64_t first = from.position / chunk_size; first < num_chunks<L>(); first += batch) {
+    uint64_t last = std::min(first + batch, num_chunks<L>());
+    const Subset_index<L> snapshot = engine.index;
+    std::atomic<uint64_t> next_chunk{first};
+
+    auto work = [&](int t) {
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+      uint64_t k;
+      while ((k = next_chunk++) < last) {
+        std::vector<Combination>& out = survivors[k - first];
+        out.clear();
+        for (auto a : chunk<L>(k))
+          group.orbit(a, [&](Combination p) {
+            if (!snapshot.covers(p)) out.push_back(p);
+            stats[t].candidates++;
+          });
+        stats[t].survivors += out.size();
+      }
+      boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
+      stats[t].seconds += (finish - start).total_microseconds() / 1e6;
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; t++)
+      workers.emplace_back(work, t);
+    for (auto& w : workers)
+      w.join();
+
+    for (uint64_t k = first; k < last; k++)
+      for (auto p : survivors[k - first])
+        engine.add(p);
+    checkpoint(engine.amir, std::min(L::num_combinations, last * chunk_size));
+  }
+  return engine.amir;
+}
+
+/*
+
+Search farm.
+
+Many randomized greedy sweeps, shared out to the worker
+threads. Run i draws everything from the random seed
+--seed + i: a permutation of the labels, applied to every
+combination of the colex sweep, a first ticket in place of
+the fixed seed, and a mirror policy. The first ticket is
+either K consecutive labels, like the original seed, or any
+ticket at all. The policies are no symmetry, the mirror of
+the labels, or the mirror of the relabelled labels, which
+makes the run the original sweep relabelled with only the
+first ticket changed. That is all the randomness, so
+--runs 1 with a logged seed does the same run again.
+
+The smallest size so far is shared by all threads through
+an atomic. A set only grows, so a run is abandoned as soon
+as it reaches that size: it can no longer do better.
+
+*/
+
+struct Farm_run
+{
+  uint64_t seed{0};
+  std::string group;
+  uint128_t first{0};
+  std::size_t size{0};
+  bool aborted{false};
+  uint64_t rank{0}; // where an aborted run stopped.
+};
+
+template<typename L>
+Amir_set<L> search_farm(int runs, int num_threads, std::uint64_t base_seed,
+                        std::vector<Farm_run>& log)
+{
+  typedef typename L::Combination Combination;
+  const Symmetry_group<L> none("none");
+  const Symmetry_group<L> mirror("mirror");
+  std::atomic<std::size_t> best_size{SIZE_MAX};
+  std::mutex best_mutex;
+  Amir_set<L> best;
+  std::atomic<int> next_run{0};
+  log.assign(runs, Farm_run());
+
+  auto work = [&]() {
+    int i;
+    while ((i = next_run++) < runs) {
+      Farm_run& run = log[i];
+      run.seed = base_seed + i;
+      std::mt19937_64 random(run.seed);
+      std::array<int, L::N> image;
+      std::iota(image.begin(), image.end(), 0);
+      std::shuffle(image.begin(), image.end(), random);
+      const Permutation<L> permutation(image);
+      int policy = random() % 3;
+      const Symmetry_group<L>& group = policy == 0 ? none : mirror;
+      run.group = policy == 0 ? "none" : policy == 1 ? "mirror" : "relabelled mirror";
+      bool block = random() & 1;
+      Combination first = block
+        ? low_bits<Combination>(L::K) << (random() % (L::N - L::K + 1))
+        : unrank_combination<L>(random() % L::num_combinations);
+      run.first = first;
+
+      Triple_engine<L> engine;
+      auto add = [&](Combination p) { engine.add(p); };
+      auto add_relabelled = [&](Combination p) { engine.add(permutation(p)); };
+      if (policy == 2)
+        group.orbit(first, add_relabelled);
+      else
+        group.orbit(first, add);
+      Colex_range<L> all(0, L::num_combinations);
+      for (auto it = all.begin(); it != all.end(); ++it) {
+        if (policy == 2)
+          group.orbit(*it, add_relabelled);
+        else
+          group.orbit(permutation(*it), add);
+        if (engine.amir.size() >= best_size) {
+          run.aborted = true;
+          run.rank = it.index();
+          break;
+        }
+      }
+      run.size = engine.amir.size();
+      if (!run.aborted) {
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if (run.size < best_size) {
+          best_size = run.size;
+          best = engine.amir;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; t++)
+    workers.emplace_back(work);
+  for (auto& w : workers)
+    w.join();
+  return best;
+}
+
+/*
+
+Max-coverage greedy.
+
+Picks, again and again, the ticket covering the most draws
+that are still uncovered. A bitmap over the draws, by rank,
+says which are covered.
+
+The gain of a ticket comes from counts kept for every
+k-subset, T <= k < K: the number of uncovered draws
+containing it. Summing the counts over the k-subsets of a
+ticket t gives
+
+  s(k) = sum over j of C(j, k) * n(j)
+
+where n(j) is the number of uncovered draws sharing exactly
+j numbers with t, and the alternating sum
+
+  gain = sum over k >= T of (-1)^(k-T) * C(k-1, T-1) * s(k)
+
+counts every draw with j >= T exactly once, the k = K term
+being the bitmap itself. For the Amir
+problem that is 42 lookups instead of a walk over 260624
+draws. A pick walks its own neighbourhood once and updates
+the counts of the draws it newly covers.
+
+Gains only go down as the set grows, so all tickets sit in
+a bucket queue under a stale upper bound of their gain
+(lazy greedy). The top candidate is rescored: if it still
+reaches the bound it was filed under it is the best left
+and is picked, otherwise it drops to the bucket of its real
+gain.
+
+*/
+
+struct Cover_stats
+{
+  long evaluations{0};
+};
+
+// Calls f with the size and colex rank (among subsets of
+// that size) of every nonempty subset of t. The ranks of the
+// 2^K subsets are built up one label at a time.
+template<typename L, typename F> void for_each_subset(typename L::Combination t, F f)
+{
+  std::array<int, L::K> x;
+  for (int i = 0; i < L::K; ++i) {
+    x[i] = lowest_bit(t);
+    t &= t - 1;
+  }
+  std::array<uint64_t, 1 << L::K> rank;
+  rank[0] = 0;
+  for (int s = 1; s < (1 << L::K); ++s) {
+    int top = 31 - __builtin_clz(s);
+    int k = popcount(uint64_t(s));
+    rank[s] = rank[s ^ (1 << top)] + binomials<L::N, L::K>.column[k][x[top]];
+    f(k, rank[s]);
+  }
+}
+
+template<typename L> Amir_set<L> max_cover(Cover_stats& stats)
+{
+  typedef typename L::Combination Combination;
+  typedef typename std::conditional<binomial(L::N - L::T, L::K - L::T) <= UINT16_MAX,
+                                    std::uint16_t, std::uint32_t>::type Count;
+  // uncovered[k][s]: uncovered draws through the k-subset s.
+  std::array<std::vector<Count>, L::K> uncovered;
+  std::array<long, L::K + 1> weight{};
+  for (int k = L::T; k < L::K; ++k)
+    uncovered[k].assign(binomial(L::N, k), binomial(L::N - k, L::K - k));
+  for (int k = L::T; k <= L::K; ++k)
+    weight[k] = ((k - L::T) % 2 ? -1 : 1) * long(binomial(k - 1, L::T - 1));
+
+  Amir_set<L> amir;
+  std::vector<bool> covered(L::num_combinations, false);
+  uint64_t left = L::num_combinations;
+  auto gain = [&](Combination t) {
+    long g = 0;
+    for_each_subset<L>(t, [&](int k, uint64_t s) {
+      if (k == L::K)
+        g += weight[k] * !covered[s];
+      else if (k >= L::T)
+        g += weight[k] * uncovered[k][s];
+    });
+    stats.evaluations++;
+    return uint64_t(g);
+  };
+  auto pick = [&](Combination t) {
+    amir.push_back(t);
+    for_each_neighbour<L>(t, [&](uint64_t d, Combination m) {
+      if (covered[d])
+        return;
+      covered[d] = true;
+      left--;
+      for_each_subset<L>(m, [&](int k, uint64_t s) {
+        if (k >= L::T && k < L::K)
+          --uncovered[k][s];
+      });
+    });
+  };
+
+  // bucket[g] holds ranks of tickets whose gain is at most
+  // g, the first in colex order on top.
+  uint64_t top = neighbourhood_size<L>();
+  std::vector<std::vector<uint32_t>> bucket(top + 1);
+  bucket[top].reserve(L::num_combinations);
+  for (uint64_t r = L::num_combinations; r-- > 0; )
+    bucket[top].push_back(r);
+
+  while (left > 0) {
+    while (bucket[top].empty())
+      --top;
+    uint32_t r = bucket[top].back();
+    bucket[top].pop_back();
+    Combination t = unrank_combination<L>(r);
+    uint64_t g = gain(t);
+    if (g == top)
+      pick(t);
+    else if (g > 0)
+      bucket[g].push_back(r);
+  }
+  return amir;
+}
+
+/*
+
+Pruning.
+
+A member is redundant when every draw it covers is covered
+by some other member as well, that is when every draw in
+its neighbourhood has a cover count of at least 2. Counts
+only go down as members are dropped, so a member that is
+needed once stays needed: one pass over the members leaves
+a set without redundant ones.
+
+Which members go depends on the order they are looked at.
+The members that are redundant in the full set are found
+first, in parallel, since the checks only read the counts.
+Then each round drops them one at a time in its own random
+order, rechecking each against its own copy of the counts.
+Rounds run in parallel and the smallest result is kept.
+
+*/
+
+struct Prune_stats
+{
+  long candidates{0};
+  long removed{0};
+  double seconds{0};
+};
+
+template<typename L>
+Amir_set<L> prune(const Amir_set<L>& amir, int num_threads, int rounds,
+                  std::uint64_t random_seed, Prune_stats& stats)
+{
+  typedef typename L::Combination Combination;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+
+  if (amir.size() > UINT16_MAX)
+    throw std::runtime_error("too many members to prune");
+  std::vector<std::uint16_t> count(L::num_combinations, 0);
+  for (auto t : amir)
+    for_each_neighbour<L>(t, [&](uint64_t d, Combination) { ++count[d]; });
+
+  auto redundant = [](const std::vector<std::uint16_t>& count, Combination t) {
+    return !any_neighbour<L>(t, [&](uint64_t d, Combination) { return count[d] < 2; });
+  };
+
+  std::vector<char> is_candidate(amir.size(), 0);
+  std::atomic<std::size_t> next{0};
+  auto work = [&]() {
+    std::size_t i;
+    while ((i = next++) < amir.size())
+      is_candidate[i] = redundant(count, amir[i]);
+  };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; t++)
+    workers.emplace_back(work);
+  for (auto& w : workers)
+    w.join();
+
+  std::vector<std::size_t> candidates;
+  for (std::size_t i = 0; i < amir.size(); ++i)
+    if (is_candidate[i])
+      candidates.push_back(i);
+  stats.candidates = candidates.size();
+
+  std::vector<std::vector<char>> removed(rounds, std::vector<char>(amir.size(), 0));
+  std::vector<long> num_removed(rounds, 0);
+  std::atomic<int> next_round{0};
+  auto round = [&]() {
+    int r;
+    while ((r = next_round++) < rounds) {
+      std::vector<std::uint16_t> c = count;
+      std::vector<std::size_t> order = candidates;
+      std::mt19937_64 random(random_seed + r);
+      std::shuffle(order.begin(), order.end(), random);
+      for (auto i : order)
+        if (redundant(c, amir[i])) {
+          for_each_neighbour<L>(amir[i], [&](uint64_t d, Combination) { --c[d]; });
+          removed[r][i] = 1;
+          num_removed[r]++;
+        }
+    }
+  };
+  workers.clear();
+  for (int t = 0; t < std::min(num_threads, rounds); t++)
+    workers.emplace_back(round);
+  for (auto& w : workers)
+    w.join();
+
+  int best = std::max_element(num_removed.begin(), num_removed.end()) - num_removed.begin();
+  stats.removed = num_removed[best];
+  const std::vector<char>& best_removed = removed[best];
+
+  Amir_set<L> result;
+  for (std::size_t i = 0; i < amir.size(); ++i)
+    if (!best_removed[i])
+      result.push_back(amir[i]);
+  boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
+  stats.seconds = (finish - start).total_microseconds() / 1e6;
+  return result;
+}
+
+/*
+
+Verifier.
+
+Reads an Amir set from a file (see set_file.h) and checks
+every one of the draws against it (13983816 of them for the
+Amir problem). For each draw we want the best match: the
+largest number of bits it has in common with any member.
+The set is good when every best match is at least T. The
+overlap kernels are in kernel.h.
+
+*/
+
+const int max_reported = 20;
+
+template<typename L> struct Verification
+{
+  std::array<long, L::K + 1> histogram{};
+  long uncovered{0};
+  Amir_set<L> first_uncovered; // at most max_reported, in colex order.
+};
+
+template<typename L>
+Verification<L> verify(const Amir_set<L>& amir, int num_threads, const std::string& isa)
+{
+  typedef typename L::Combination Combination;
+  Overlap_kernel<Combination> kernel = Kernels<L>::overlap(isa);
+  Member_array<Combination> members;
   for (auto a : amir)
-    if (equivalent(a, p)) {
-      not_in_amir = false;
+    members.push_back(a);
+
+  std::vector<Amir_set<L>> uncovered(num_chunks<L>());
+  std::vector<Verification<L>> partial(num_threads);
+  std::atomic<uint64_t> next_chunk{0};
+
+  auto work = [&](int t) {
+    uint64_t k;
+    while ((k = next_chunk++) < num_chunks<L>()) {
+      for (auto d : chunk<L>(k)) {
+        int best = kernel(members.begin(), members.padded_size(), d);
+        partial[t].histogram[best]++;
+        if (best < L::T && uncovered[k].size() < max_reported)
+          uncovered[k].push_back(d);
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; t++)
+    workers.emplace_back(work, t);
+  for (auto& w : workers)
+    w.join();
+
+  Verification<L> result;
+  for (auto& p : partial)
+    for (int j = 0; j <= L::K; j++)
+      result.histogram[j] += p.histogram[j];
+  for (int j = 0; j < L::T; j++)
+    result.uncovered += result.histogram[j];
+  for (auto& u : uncovered)
+    for (auto d : u)
+      if (result.first_uncovered.size() < max_reported)
+        result.first_uncovered.push_back(d);
+  return result;
+}
+
+template<typename L>
+int run_verify(const std::string& filename, int num_threads, const std::string& isa)
+{
+  if (!std::ifstream(filename)) {
+    std::cout << "No such file: " << filename << std::endl;
+    return 1;
+  }
+  Amir_set<L> amir = load_amir_set<L>(filename);
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  Verification<L> v = verify<L>(amir, num_threads, isa);
+  boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
+
+  std::cout << "amir set: " << filename << ", " << amir.size() << " elements" << std::endl;
+  std::cout << "best match histogram:" << std::endl;
+  for (int j = 0; j <= L::K; j++)
+    std::cout << std::setw(3) << j << std::setw(12) << v.histogram[j] << std::endl;
+  for (auto d : v.first_uncovered)
+    std::cout << "uncovered: " << to_bitset<L>(d) << std::endl;
+  long listed = v.first_uncovered.size();
+  if (v.uncovered > listed)
+    std::cout << "... and " << v.uncovered - listed << " more" << std::endl;
+  std::cout << "uncovered draws: " << v.uncovered << std::endl;
+  std::cout << "time: " << finish - start << " (" << num_threads << " threads, "
+            << isa << ")" << std::endl;
+  return v.uncovered == 0 ? 0 : 1;
+}
+
+/*
+
+Annealer.
+
+Local search below the greedy result, seeded from a set file.
+
+Every draw has a cover count: the number of members sharing
+at least T numbers with it. A ticket touches only its own
+neighbourhood (260624 draws for the Amir problem, see
+cover.h), so adding or removing a ticket, or scoring a swap,
+walks those draws and nothing else. Uncovered draws are
+kept in a list with a position index, so one can be sampled
+in constant time.
+
+Members live in fixed slots. Each draw also keeps the xor of
+the slots of the members covering it, which is the slot of
+its only member when the count is 1. That way every member
+keeps its sole count, the number of draws nobody else
+covers, and the cheapest member is a look over the slots.
+
+The search keeps the set size m fixed and minimizes the
+number of uncovered draws with simulated annealing. A swap
+replaces a random member with a ticket through T numbers of
+a random uncovered draw. Recently removed tickets are tabu
+for a while. When nothing is left uncovered the set is the
+new best: it is checkpointed, the cheapest member is dropped
+and the search goes on at size m - 1. The temperature cools
+geometrically and is reheated when it gets too low, so long
+runs keep exploring.
+
+*/
+
+template<typename L> class Annealer
+{
+public:
+  typedef typename L::Combination Combination;
+  Annealer(const Amir_set<L>& seed, std::uint64_t random_seed);
+  void run(double seconds, double temperature, const std::string& checkpoint);
+  const Amir_set<L>& best() const { return best_set; }
+  long moves{0};
+private:
+  void add(Combination t);
+  void remove(int s);
+  long swap_delta(int s, Combination a) const;
+  int cheapest_member() const;
+  int random_member();
+  Combination random_ticket_through(Combination u);
+  bool is_tabu(Combination a) const;
+  Amir_set<L> members() const;
+  void save(const std::string& filename) const;
+  std::vector<Combination> slot; // 0 when free.
+  std::vector<int> free_slots;
+  std::vector<long> sole; // by slot.
+  std::size_t size{0};
+  Amir_set<L> best_set;
+  std::vector<std::uint16_t> count;
+  std::vector<std::uint16_t> owner; // xor of the covering slots.
+  std::vector<Combination> uncovered;
+  std::vector<std::uint32_t> position; // of each draw in uncovered, by rank.
+  std::vector<Combination> tabu;
+  std::size_t tabu_next{0};
+  std::mt19937_64 random;
+  static const std::uint32_t covered = UINT32_MAX; // position of covered draws.
+};
+
+template<typename L> const std::uint32_t Annealer<L>::covered;
+
+const int tabu_tenure = 16;
+
+template<typename L>
+Annealer<L>::Annealer(const Amir_set<L>& seed, std::uint64_t random_seed)
+  : slot(seed.size(), 0), sole(seed.size(), 0),
+    count(L::num_combinations, 0), owner(L::num_combinations, 0),
+    position(L::num_combinations, covered), tabu(tabu_tenure, 0), random(random_seed)
+{
+  if (seed.size() > UINT16_MAX)
+    throw std::runtime_error("too many members for the local search");
+  if (L::num_combinations >= covered)
+    throw std::runtime_error("too many draws for the local search");
+  for (int s = seed.size() - 1; s >= 0; --s)
+    free_slots.push_back(s);
+  Colex_range<L> all(0, L::num_combinations);
+  for (auto it = all.begin(); it != all.end(); ++it) {
+    position[it.index()] = uncovered.size();
+    uncovered.push_back(*it);
+  }
+  for (auto t : seed)
+    add(t);
+  if (uncovered.empty())
+    best_set = members();
+}
+
+template<typename L> void Annealer<L>::add(Combination t)
+{
+  int s = free_slots.back();
+  free_slots.pop_back();
+  slot[s] = t;
+  size++;
+  for_each_neighbour<L>(t, [&](uint64_t d, Combination) {
+    int c = count[d]++;
+    if (c == 0) {
+      std::uint32_t p = position[d];
+      position[rank_combination<L>(uncovered.back())] = p;
+      uncovered[p] = uncovered.back();
+      uncovered.pop_back();
+      position[d] = covered;
+      sole[s]++;
+    } else if (c == 1) {
+      sole[owner[d]]--;
+    }
+    owner[d] ^= s;
+  });
+}
+
+template<typename L> void Annealer<L>::remove(int s)
+{
+  Combination t = slot[s];
+  slot[s] = 0;
+  free_slots.push_back(s);
+  size--;
+  tabu[tabu_next++ % tabu_tenure] = t;
+  for_each_neighbour<L>(t, [&](uint64_t d, Combination m) {
+    owner[d] ^= s;
+    int c = --count[d];
+    if (c == 0) {
+      position[d] = uncovered.size();
+      uncovered.push_back(m);
+    } else if (c == 1) {
+      sole[owner[d]]++;
+    }
+  });
+  sole[s] = 0;
+}
+
+// Change in the number of uncovered draws if the member in
+// slot s is replaced by a: the draws only s covers, less
+// those a covers too, minus the draws nobody covers and a
+// does.
+template<typename L> long Annealer<L>::swap_delta(int s, Combination a) const
+{
+  long kept = 0;
+  long gained = 0;
+  for_each_neighbour<L>(a, [&](uint64_t d, Combination) {
+    if (count[d] == 0) ++gained;
+    else if (count[d] == 1 && owner[d] == s) ++kept;
+  });
+  return sole[s] - kept - gained;
+}
+
+// The member whose removal uncovers the fewest draws.
+template<typename L> int Annealer<L>::cheapest_member() const
+{
+  int best = -1;
+  for (std::size_t s = 0; s < slot.size(); ++s)
+    if (slot[s] != 0 && (best < 0 || sole[s] < sole[best]))
+      best = s;
+  return best;
+}
+
+template<typename L> int Annealer<L>::random_member()
+{
+  std::uniform_int_distribution<int> pick(0, slot.size() - 1);
+  int s;
+  do
+    s = pick(random);
+  while (slot[s] == 0);
+  return s;
+}
+
+// T random numbers of u plus K - T random others.
+template<typename L>
+typename L::Combination Annealer<L>::random_ticket_through(Combination u)
+{
+  std::array<int, L::K> x;
+  for (int i = 0; i < L::K; ++i) {
+    x[i] = lowest_bit(u);
+    u &= u - 1;
+  }
+  std::shuffle(x.begin(), x.end(), random);
+  Combination a = 0;
+  for (int i = 0; i < L::T; ++i)
+    a |= Combination{1} << x[i];
+  std::uniform_int_distribution<int> label(0, L::N - 1);
+  while (popcount(a) < L::K)
+    a |= Combination{1} << label(random);
+  return a;
+}
+
+template<typename L> bool Annealer<L>::is_tabu(Combination a) const
+{
+  return std::find(tabu.begin(), tabu.end(), a) != tabu.end()
+    || std::find(slot.begin(), slot.end(), a) != slot.end();
+}
+
+template<typename L> Amir_set<L> Annealer<L>::members() const
+{
+  Amir_set<L> amir;
+  for (auto t : slot)
+    if (t != 0)
+      amir.push_back(t);
+  return amir;
+}
+
+template<typename L> void Annealer<L>::save(const std::string& filename) const
+{
+  write_text_set<L>(filename, best_set);
+}
+
+template<typename L>
+void Annealer<L>::run(double seconds, double temperature, const std::string& checkpoint)
+{
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  boost::posix_time::ptime report = start;
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  double t = temperature;
+  while (size > 0) {
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+    if ((now - start).total_milliseconds() > 1000 * seconds)
       break;
+    if ((now - report).total_seconds() >= 10) {
+      std::cout << "size " << size << ": " << uncovered.size()
+                << " uncovered, " << moves << " moves, temperature " << t << std::endl;
+      report = now;
     }
-  if (not_in_amir)
-    amir.push_back(p);
+
+    if (uncovered.empty()) {
+      best_set = members();
+      save(checkpoint);
+      std::cout << "size " << size << ": covered, checkpoint "
+                << checkpoint << std::endl;
+      remove(cheapest_member());
+      t = temperature;
+      continue;
+    }
+
+    std::uniform_int_distribution<std::size_t> pick_draw(0, uncovered.size() - 1);
+    Combination u = uncovered[pick_draw(random)];
+    int s = random_member();
+    Combination a = random_ticket_through(u);
+    if (is_tabu(a))
+      continue;
+    long delta = swap_delta(s, a);
+    ++moves;
+    if (delta <= 0 || uniform(random) < std::exp(-delta / t)) {
+      remove(s);
+      add(a);
+    }
+    t *= 0.999;
+    if (t < 0.5)
+      t = temperature;
+  }
 }
 
-int main()
+template<typename L>
+int run_anneal(const std::string& filename, double seconds, double temperature,
+               std::uint64_t random_seed, const std::string& checkpoint)
 {
+  if (!std::ifstream(filename)) {
+    std::cout << "No such file: " << filename << std::endl;
+    return 1;
+  }
+  Amir_set<L> seed = load_amir_set<L>(filename);
+  if (seed.empty()) {
+    std::cout << "No members in " << filename << std::endl;
+    return 1;
+  }
+
   boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  Annealer<L> annealer(seed, random_seed);
+  annealer.run(seconds, temperature, checkpoint);
+  boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
+  boost::posix_time::time_duration time_taken = finish - start;
 
-  // Add combinations and their mirrors to the amir set.
-  Combination seed = 0b111111000000000000000000;
-  Amir_set amir;
-  add_to_amir_set(amir, seed);
-  add_to_amir_set(amir, mirror_combination(seed, 49));
+  for (auto u : annealer.best())
+    std::cout << to_bitset<L>(u) << std::endl;
+  std::cout << "seed: " << filename << ", " << seed.size() << " elements, random seed "
+            << random_seed << std::endl;
+  std::cout << "moves: " << annealer.moves << ", "
+            << annealer.moves / (time_taken.total_milliseconds() / 1000.0 + 1e-9)
+            << " per second" << std::endl;
+  std::cout << "amir set size: " << annealer.best().size() << std::endl;
+  std::cout << "time: " << time_taken << std::endl;
+  return 0;
+}
+
+template<typename L> void print_prune_stats(const Prune_stats& stats, std::size_t size)
+{
+  std::cout << "pruned: " << stats.removed << " of " << size << " members removed ("
+            << stats.candidates << " redundant to begin with), "
+            << std::fixed << std::setprecision(3) << stats.seconds << " s" << std::endl;
+}
 
-  // First combination is 63: 0b111111
-  Combination a = 0b111111;
-  Combination c, r;
-  for (int i = 0; i < num_combinations; i++) {
-    add_to_amir_set(amir, a);
-    add_to_amir_set(amir, mirror_combination(a, 49));
-    c = a & -a;
-    r = a + c;
-    a = (((r ^ a) >> 2) / c) | r;
+template<typename L>
+int run_prune(const std::string& filename, int num_threads, int rounds,
+              std::uint64_t random_seed, const std::string& output)
+{
+  if (!std::ifstream(filename)) {
+    std::cout << "No such file: " << filename << std::endl;
+    return 1;
   }
+  Amir_set<L> amir = load_amir_set<L>(filename);
+  Prune_stats stats;
+  Amir_set<L> pruned = prune<L>(amir, num_threads, rounds, random_seed, stats);
+  for (auto u : pruned)
+    std::cout << to_bitset<L>(u) << std::endl;
+  if (!output.empty())
+    write_binary_set<L>(output, pruned);
+  print_prune_stats<L>(stats, amir.size());
+  std::cout << "amir set size: " << pruned.size() << std::endl;
+  return 0;
+}
+
+struct App {
+  App(int, char**);
+  std::string lottery;
+  int match;
+  std::string engine;
+  std::string group;
+  std::string isa;
+  int threads;
+  std::string verify_file;
+  std::string anneal_file;
+  std::string prune_file;
+  int prune_rounds;
+  std::string output_file;
+  std::string convert_file;
+  std::string state_file;
+  std::string resume_file;
+  double checkpoint_every;
+  int bench_runs;
+  bool json;
+  std::string checkpoint_file;
+  int runs;
+  double seconds;
+  double temperature;
+  std::uint64_t random_seed;
+  bpo::options_description description;
+  bpo::variables_map vm;
+  std::string help();
+};
+
+App::App(int argc, char* argv[])
+  : description{"Allowed options"}
+{
+  description.add_options()
+    ("help,h",
+     "show help message")
+
+    ("lottery,l",
+     bpo::value<std::string>(&lottery)->default_value("6/49"),
+     "5/35 | 6/49 | 6/59 | 7/80")
+
+    ("match,m",
+     bpo::value<int>(&match)->default_value(3),
+     "numbers to match: 3, or 4 for 6/49 and 7/80")
+
+    ("engine,e",
+     bpo::value<std::string>(&engine)->default_value("scan"),
+     "scan | triples | simd | parallel | orbits | maxcover | farm | exact")
+
+    ("group,g",
+     bpo::value<std::string>(&group)->default_value("mirror"),
+     "symmetry group for the sweep: none | mirror | cyclic | dihedral | affine")
+
+    ("threads,t",
+     bpo::value<int>(&threads)->default_value(std::max(1u, std::thread::hardware_concurrency())),
+     "worker threads, for the parallel and farm engines, pruning and the verifier")
+
+    ("runs",
+     bpo::value<int>(&runs)->default_value(16),
+     "randomized sweeps for the farm engine")
+
+    ("verify,v",
+     bpo::value<std::string>(&verify_file),
+     "check that an Amir set file covers every draw")
+
+    ("prune,p",
+     bpo::value<std::string>(&prune_file)->implicit_value(""),
+     "drop redundant members of the search result, or of the Amir set in this file")
+
+    ("prune-rounds",
+     bpo::value<int>(&prune_rounds)->default_value(8),
+     "random orders tried by the pruning stage")
+
+    ("output,o",
+     bpo::value<std::string>(&output_file),
+     "also write the resulting set to this file, in binary")
+
+    ("convert,c",
+     bpo::value<std::string>(&convert_file),
+     "convert this set file, text to binary or back, into the --output file")
+
+    ("checkpoint-every",
+     bpo::value<double>(&checkpoint_every)->default_value(0),
+     "seconds between checkpoints of a sweep, 0 for none")
+
+    ("state",
+     bpo::value<std::string>(&state_file)->default_value("amir-state.bin"),
+     "where sweeps save their checkpoints")
+
+    ("resume",
+     bpo::value<std::string>(&resume_file),
+     "continue the sweep saved in this checkpoint")
+
+    ("bench",
+     bpo::value<int>(&bench_runs),
+     "time this many runs of the engine and count its work")
+
+    ("json",
+     bpo::bool_switch(&json),
+     "benchmark results as JSON")
+
+    ("anneal,a",
+     bpo::value<std::string>(&anneal_file),
+     "local search below the Amir set in this file")
+
+    ("seconds",
+     bpo::value<double>(&seconds)->default_value(60),
+     "time limit for the local search")
+
+    ("temperature",
+     bpo::value<double>(&temperature)->default_value(20),
+     "starting temperature for the local search")
+
+    ("seed",
+     bpo::value<std::uint64_t>(&random_seed)->default_value(0),
+     "random seed for the local search, pruning and the farm")
+
+    ("checkpoint",
+     bpo::value<std::string>(&checkpoint_file)->default_value("amir-best.txt"),
+     "where the local search saves its best set")
+
+    ("isa",
+     bpo::value<std::string>(&isa)->default_value(best_isa()),
+     "avx512 | avx2 | scalar, for the simd engine and the verifier");
+
+  bpo::store(bpo::parse_command_line(argc, argv, description), vm);
+  bpo::notify(vm);
+}
+
+std::string App::help()
+{
+  std::ostringstream out;
+  out << "Usage: amir [options]" << std::endl << description;
+  return out.str();
+}
+
+// Everything the engines report besides the set.
+template<typename L> struct Search_stats
+{
+  std::vector<Thread_stats> threads;
+  Orbit_stats orbits;
+  Cover_stats cover;
+  std::vector<Farm_run> farm;
+  std::vector<typename Exact_solver<L>::Round> exact;
+};
+
+// Runs the engine chosen with --engine.
+template<typename L>
+Amir_set<L> search(const App& app, const Symmetry_group<L>& group, const Sweep_state<L>& from,
+                   Checkpointer<L>& checkpoint, Search_stats<L>& stats)
+{
+  if (app.engine == "scan") {
+    Scan_engine<L> engine;
+    return greedy_sweep<L>(engine, group, from, checkpoint);
+  }
+  if (app.engine == "triples") {
+    Triple_engine<L> engine;
+    return greedy_sweep<L>(engine, group, from, checkpoint);
+  }
+  if (app.engine == "simd") {
+    Simd_engine<L> engine(app.isa);
+    return greedy_sweep<L>(engine, group, from, checkpoint);
+  }
+  if (app.engine == "parallel")
+    return parallel_sweep<L>(app.threads, group, from, checkpoint, stats.threads);
+  if (app.engine == "orbits")
+    return orbit_sweep<L>(group, stats.orbits);
+  if (app.engine == "maxcover")
+    return max_cover<L>(stats.cover);
+  if (app.engine == "farm")
+    return search_farm<L>(app.runs, app.threads, app.random_seed, stats.farm);
+  if (app.engine == "exact") {
+    Exact_solver<L> solver;
+    return solver.solve(app.threads, stats.exact);
+  }
+  throw std::runtime_error("unknown engine: " + app.engine);
+}
+
+/*
+
+Benchmarks.
+
+--bench N runs the chosen engine N times and reports the
+minimum and median wall time. The timed runs are the plain
+engines, with nothing counted. For the sweep engines one
+more sweep is instrumented to count the work:
+
+  candidates    combinations and images offered to the set
+  tests         what a candidate is compared with: members
+                (scan), T-subsets (triples, parallel) or
+                batches of 8 members (simd)
+  early exits   candidates whose tests stopped before the
+                last one
+  growth        time and colex rank at which each member
+                joined
+
+Peak RSS is the high water mark of the whole process, from
+getrusage. With --json all of it comes out as one JSON
+object instead.
+
+*/
+
+struct Growth
+{
+  double seconds;
+  uint64_t rank;
+  std::size_t size;
+};
+
+struct Sweep_profile
+{
+  long candidates{0};
+  long tests{0};
+  long early_exits{0};
+  std::vector<Growth> growth;
+};
+
+template<typename L>
+Sweep_profile profile_sweep(const std::string& engine, const Symmetry_group<L>& group)
+{
+  typedef typename L::Combination Combination;
+  enum { scan, triples, batches } mode = engine == "scan" ? scan
+    : engine == "simd" ? batches : triples;
+  Sweep_profile profile;
+  Amir_set<L> amir;
+  Subset_index<L> index;
+  uint64_t rank = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+
+  auto add = [&](Combination p) {
+    profile.candidates++;
+    long tests = 0;
+    long available = 0;
+    bool covered = false;
+    if (mode == triples) {
+      int probes;
+      covered = index.covers(p, probes);
+      tests = probes;
+      available = binomial(L::K, L::T);
+    } else {
+      std::size_t step = mode == scan ? 1 : 8;
+      available = (amir.size() + step - 1) / step;
+      for (std::size_t i = 0; i < amir.size() && !covered; i += step) {
+        tests++;
+        for (std::size_t j = i; j < std::min(i + step, amir.size()); ++j)
+          covered = covered || equivalent<L>(amir[j], p);
+      }
+    }
+    profile.tests += tests;
+    if (covered) {
+      if (tests < available)
+        profile.early_exits++;
+      return;
+    }
+    amir.push_back(p);
+    index.insert(p);
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
+    profile.growth.push_back(Growth{(now - start).total_microseconds() / 1e6, rank, amir.size()});
+  };
+
+  group.orbit(seed_combination<L>(), add);
+  Colex_range<L> all(0, L::num_combinations);
+  for (auto it = all.begin(); it != all.end(); ++it) {
+    rank = it.index();
+    group.orbit(*it, add);
+  }
+  return profile;
+}
+
+// In kilobytes.
+inline long peak_rss()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+template<typename L> int run_bench(const App& app)
+{
+  if (app.bench_runs < 1) {
+    std::cout << "Need at least one benchmark run." << std::endl;
+    return 1;
+  }
+  Symmetry_group<L> group(app.group);
+  Sweep_state<L> from;
+  from.position = 0;
+  std::vector<double> seconds;
+  std::size_t size = 0;
+  for (int r = 0; r < app.bench_runs; ++r) {
+    Checkpointer<L> checkpoint(app.state_file, 0);
+    Search_stats<L> stats;
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+    size = search<L>(app, group, from, checkpoint, stats).size();
+    boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
+    seconds.push_back((finish - start).total_microseconds() / 1e6);
+  }
+  std::vector<double> sorted = seconds;
+  std::sort(sorted.begin(), sorted.end());
+  double min = sorted.front();
+  double median = sorted.size() % 2 ? sorted[sorted.size() / 2]
+    : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+
+  bool sweep = app.engine == "scan" || app.engine == "triples"
+    || app.engine == "simd" || app.engine == "parallel";
+  Sweep_profile profile;
+  if (sweep)
+    profile = profile_sweep<L>(app.engine, group);
+
+  std::ostringstream out;
+  if (app.json) {
+    out << "{\"lottery\": \"" << L::K << "/" << L::N << "\", \"match\": " << L::T
+        << ", \"engine\": \"" << app.engine << "\", \"group\": \"" << app.group
+        << "\", \"threads\": " << app.threads << ", \"isa\": \"" << app.isa
+        << "\", \"set_size\": " << size << ", \"seconds\": [";
+    for (std::size_t r = 0; r < seconds.size(); ++r)
+      out << (r ? ", " : "") << seconds[r];
+    out << "], \"min\": " << min << ", \"median\": " << median;
+    if (sweep) {
+      out << ", \"candidates\": " << profile.candidates
+          << ", \"candidates_per_second\": " << profile.candidates / min
+          << ", \"tests\": " << profile.tests
+          << ", \"early_exit_rate\": " << double(profile.early_exits) / profile.candidates
+          << ", \"growth\": [";
+      for (std::size_t i = 0; i < profile.growth.size(); ++i)
+        out << (i ? ", " : "") << "[" << profile.growth[i].seconds << ", "
+            << profile.growth[i].rank << ", " << profile.growth[i].size << "]";
+      out << "]";
+    }
+    out << ", \"peak_rss_kb\": " << peak_rss() << "}" << std::endl;
+  } else {
+    out << "lottery: " << L::K << "/" << L::N << ", match " << L::T << std::endl;
+    out << "engine: " << app.engine << ", group " << app.group << std::endl;
+    out << "amir set size: " << size << std::endl;
+    out << std::fixed << std::setprecision(3);
+    out << "runs: " << seconds.size() << ", min " << min << " s, median " << median
+        << " s" << std::endl;
+    if (sweep) {
+      out << "candidates: " << profile.candidates << ", " << std::setprecision(1)
+          << profile.candidates / min / 1e6 << " M/s at the minimum" << std::endl;
+      out << "tests: " << profile.tests << ", " << std::setprecision(2)
+          << double(profile.tests) / profile.candidates << " per candidate" << std::endl;
+      out << "early exits: " << std::setprecision(1)
+          << 100.0 * profile.early_exits / profile.candidates << "%" << std::endl;
+      // Sizes that are powers of 2, and the last one.
+      out << "growth:" << std::setprecision(3);
+      for (auto& g : profile.growth)
+        if ((g.size & (g.size - 1)) == 0 || g.size == profile.growth.size())
+          out << (g.size > 1 ? ", " : " ") << g.size << " at rank " << g.rank
+              << " (" << g.seconds << " s)";
+      out << std::endl;
+    }
+    out << "peak rss: " << peak_rss() << " kB" << std::endl;
+  }
+  std::cout << out.str();
+  return 0;
+}
+
+// Binary files become text and everything else binary.
+template<typename L> int run_convert(const std::string& filename, const std::string& output)
+{
+  if (!std::ifstream(filename)) {
+    std::cout << "No such file: " << filename << std::endl;
+    return 1;
+  }
+  if (output.empty()) {
+    std::cout << "Need an --output file to convert to." << std::endl;
+    return 1;
+  }
+  bool binary = is_binary_set_file(filename);
+  Sweep_state<L> state = load_sweep_state<L>(filename);
+  if (binary)
+    write_text_set<L>(output, state.amir, state.width);
+  else
+    write_binary_set<L>(output, state.amir, state.position, state.width);
+  std::cout << state.amir.size() << " members written to " << output
+            << (binary ? " as text" : " as binary") << std::endl;
+  return 0;
+}
+
+// Greedy sweep, pruning, conversion, local search, benchmark
+// or verification for one lottery.
+template<typename L> int run_lottery(const App& app)
+{
+  if (app.vm.count("verify"))
+    return run_verify<L>(app.verify_file, app.threads, app.isa);
+  if (app.vm.count("convert"))
+    return run_convert<L>(app.convert_file, app.output_file);
+  if (app.vm.count("anneal"))
+    return run_anneal<L>(app.anneal_file, app.seconds, app.temperature,
+                         app.random_seed, app.checkpoint_file);
+  if (!app.prune_file.empty())
+    return run_prune<L>(app.prune_file, app.threads, app.prune_rounds, app.random_seed,
+                        app.output_file);
+  if (app.vm.count("bench"))
+    return run_bench<L>(app);
+
+  bool sweep = app.engine == "scan" || app.engine == "triples"
+    || app.engine == "simd" || app.engine == "parallel";
+  if (!sweep && (app.vm.count("resume") || app.checkpoint_every > 0)) {
+    std::cout << "Checkpoints are for the scan, triples, simd and parallel engines."
+              << std::endl;
+    return 1;
+  }
+  Sweep_state<L> from;
+  from.position = 0;
+  if (app.vm.count("resume")) {
+    if (!std::ifstream(app.resume_file)) {
+      std::cout << "No such file: " << app.resume_file << std::endl;
+      return 1;
+    }
+    from = load_sweep_state<L>(app.resume_file);
+  }
+  Checkpointer<L> checkpoint(app.state_file, app.checkpoint_every);
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+
+  Symmetry_group<L> group(app.group);
+  Search_stats<L> stats;
+  Amir_set<L> amir = search<L>(app, group, from, checkpoint, stats);
+
+  std::size_t unpruned = amir.size();
+  Prune_stats prune_stats;
+  if (app.vm.count("prune"))
+    amir = prune<L>(amir, app.threads, app.prune_rounds, app.random_seed, prune_stats);
 
   boost::posix_time::ptime finish = boost::posix_time::microsec_clock::local_time();
   boost::posix_time::time_duration time_taken = finish - start;
 
   for (auto u : amir)
-    std::cout << std::setfill('0') << std::bitset<49>(u) << std::endl;
+    std::cout << to_bitset<L>(u) << std::endl;
+  if (!app.output_file.empty())
+    write_binary_set<L>(app.output_file, amir);
 
+  std::cout << "lottery: " << L::K << "/" << L::N << ", match " << L::T << std::endl;
+  // The farm draws its own mirror policies, and maxcover and
+  // exact use no group at all.
+  if (sweep || app.engine == "orbits")
+    std::cout << "group: " << app.group << ", order " << group.order() << std::endl;
+  std::cout << "engine: " << app.engine;
+  if (app.engine == "simd")
+    std::cout << " (" << (L::N <= 64 ? app.isa : "scalar") << ")";
+  if (app.engine == "parallel")
+    std::cout << " (" << app.threads << " threads)";
+  std::cout << std::endl;
+  if (app.vm.count("resume"))
+    std::cout << "resumed: " << app.resume_file << " at rank " << from.position
+              << ", " << from.amir.size() << " members" << std::endl;
+  if (checkpoint.saves > 0)
+    std::cout << "checkpoints: " << checkpoint.saves << " to " << app.state_file << std::endl;
+  if (app.engine == "orbits")
+    std::cout << "visited: " << stats.orbits.visited
+              << ", representatives: " << stats.orbits.representatives
+              << ", orbits added: " << stats.orbits.orbits << std::endl;
+  for (std::size_t i = 0; i < stats.farm.size(); i++) {
+    const Farm_run& run = stats.farm[i];
+    std::cout << "run " << i << ": seed " << run.seed << ", group " << run.group
+              << ", first " << to_bitset<L>(run.first);
+    if (run.aborted)
+      std::cout << ", aborted at " << run.size << " members, rank " << run.rank << std::endl;
+    else
+      std::cout << ", size " << run.size << std::endl;
+  }
+  for (auto& round : stats.exact)
+    std::cout << "size " << round.size << ": " << round.nodes << " nodes, "
+              << (round.found ? "cover found" : "no cover") << std::endl;
+  if (app.engine == "maxcover")
+    std::cout << "gain evaluations: " << stats.cover.evaluations << std::endl;
+  for (std::size_t t = 0; t < stats.threads.size(); t++)
+    std::cout << "thread " << t << ": "
+              << stats.threads[t].candidates << " candidates, "
+              << stats.threads[t].survivors << " survivors, "
+              << std::fixed << std::setprecision(3) << stats.threads[t].seconds << " s, "
+              << std::setprecision(1)
+              << (stats.threads[t].seconds > 0
+                  ? stats.threads[t].candidates / stats.threads[t].seconds / 1e6 : 0.0)
+              << " M candidates/s" << std::endl;
+  if (app.vm.count("prune"))
+    print_prune_stats<L>(prune_stats, unpruned);
   std::cout << "amir set size: " << amir.size() << std::endl;
   std::cout << "time: " << time_taken << std::endl;
 
   return 0;
 }
+
+template<typename L> bool is_lottery(const App& app)
+{
+  return app.lottery == std::to_string(L::K) + "/" + std::to_string(L::N)
+    && app.match == L::T;
+}
+
+int main(int argc, char* argv[])
+{
+  try {
+    App app(argc, argv);
+    if (app.vm.count("help")) {
+      std::cout << app.help();
+      return 0;
+    }
+    if (app.threads < 1) {
+      std::cout << "Need at least one thread." << std::endl;
+      return 1;
+    }
+    if (app.prune_rounds < 1) {
+      std::cout << "Need at least one pruning round." << std::endl;
+      return 1;
+    }
+    if (isa_rank(app.isa) < 0) {
+      std::cout << "Unknown instruction set: " << app.isa
+                << " (avx512 | avx2 | scalar)" << std::endl;
+      return 1;
+    }
+    if (isa_rank(app.isa) > isa_rank(best_isa())) {
+      std::cout << "This cpu has no " << app.isa << ", the widest it has is "
+                << best_isa() << "." << std::endl;
+      return 1;
+    }
+
+    // Lotteries compiled in.
+    if (is_lottery<Lottery<12, 6, 3>>(app)) return run_lottery<Lottery<12, 6, 3>>(app);
+    if (is_lottery<Lottery<13, 6, 3>>(app)) return run_lottery<Lottery<13, 6, 3>>(app);
+    if (is_lottery<Lottery<14, 6, 3>>(app)) return run_lottery<Lottery<14, 6, 3>>(app);
+    if (is_lottery<Lottery<15, 6, 3>>(app)) return run_lottery<Lottery<15, 6, 3>>(app);
+    if (is_lottery<Lottery<16, 6, 3>>(app)) return run_lottery<Lottery<16, 6, 3>>(app);
+    if (is_lottery<Lottery<17, 6, 3>>(app)) return run_lottery<Lottery<17, 6, 3>>(app);
+    if (is_lottery<Lottery<18, 6, 3>>(app)) return run_lottery<Lottery<18, 6, 3>>(app);
+    if (is_lottery<Lottery<19, 6, 3>>(app)) return run_lottery<Lottery<19, 6, 3>>(app);
+    if (is_lottery<Lottery<20, 6, 3>>(app)) return run_lottery<Lottery<20, 6, 3>>(app);
+    if (is_lottery<Lottery<35, 5, 3>>(app)) return run_lottery<Lottery<35, 5, 3>>(app);
+    if (is_lottery<Lottery<49, 6, 3>>(app)) return run_lottery<Lottery<49, 6, 3>>(app);
+    if (is_lottery<Lottery<49, 6, 4>>(app)) return run_lottery<Lottery<49, 6, 4>>(app);
+    if (is_lottery<Lottery<59, 6, 3>>(app)) return run_lottery<Lottery<59, 6, 3>>(app);
+    if (is_lottery<Lottery<80, 7, 3>>(app)) return run_lottery<Lottery<80, 7, 3>>(app);
+    if (is_lottery<Lottery<80, 7, 4>>(app)) return run_lottery<Lottery<80, 7, 4>>(app);
+
+    std::cout << "Unknown lottery: " << app.lottery << ", match " << app.match << std::endl;
+    return 1;
+  } catch (std::exception& e) {
+    std::cerr << "error: " << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,194 @@
+#ifndef COMBINATION_H
+#define COMBINATION_H
+
+#include <array>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <type_traits>
+
+/*
+
+Combinations of K out of N numbers are bit-permutations of
+numbers having popcount of K in an N-bit wide field. For
+N <= 64 the field is a uint64_t, up to N = 128 it is a two
+word unsigned __int128.
+
+A Lottery<N, K, T> fixes the field, the ticket size and the
+match threshold T at compile time: two combinations are
+equivalent when they have at least T numbers in common.
+The Amir problem is Lottery<49, 6, 3>.
+
+Combinations are numbered densely from 0 by their colex
+rank. With bit positions x0 < x1 < ... < x(K-1) the rank is
+
+  C(x0,1) + C(x1,2) + ... + C(x(K-1),K)
+
+Unranking goes the other way, from the top: x(K-1) is the
+largest x with C(x,K) <= rank, and so on down with what is
+left. Each step is a binary search in one column of the
+binomial table, so both directions take a fixed number of
+table lookups.
+
+Per-draw arrays (bitmaps, counters) are indexed by rank,
+and any range of ranks can be walked lazily with a
+Colex_range, starting from its unranked first element.
+
+*/
+
+typedef unsigned __int128 uint128_t;
+
+// Exact at every step: a product of i+1 consecutive
+// numbers is divisible by (i+1)!.
+constexpr uint64_t binomial(int n, int k)
+{
+  if (k < 0 || k > n) return 0;
+  if (k > n - k) k = n - k;
+  uint64_t result = 1;
+  for (int i = 0; i < k; ++i)
+    result = result * (n - i) / (i + 1);
+  return result;
+}
+
+template<int N> using Mask =
+  typename std::conditional<(N <= 64), uint64_t, uint128_t>::type;
+
+template<int N_, int K_, int T_> struct Lottery
+{
+  static_assert(0 < T_ && T_ <= K_ && K_ <= N_ && N_ <= 128, "bad lottery");
+  static constexpr int N = N_;
+  static constexpr int K = K_;
+  static constexpr int T = T_;
+  typedef Mask<N> Combination;
+  static constexpr uint64_t num_combinations = binomial(N, K);
+};
+
+template<int N_, int K_, int T_> constexpr int Lottery<N_, K_, T_>::N;
+template<int N_, int K_, int T_> constexpr int Lottery<N_, K_, T_>::K;
+template<int N_, int K_, int T_> constexpr int Lottery<N_, K_, T_>::T;
+template<int N_, int K_, int T_> constexpr uint64_t Lottery<N_, K_, T_>::num_combinations;
+
+constexpr int popcount(uint64_t x) { return __builtin_popcountll(x); }
+constexpr int popcount(uint128_t x)
+{
+  return __builtin_popcountll(uint64_t(x)) + __builtin_popcountll(uint64_t(x >> 64));
+}
+
+constexpr int lowest_bit(uint64_t x) { return __builtin_ctzll(x); }
+constexpr int lowest_bit(uint128_t x)
+{
+  return uint64_t(x) ? __builtin_ctzll(uint64_t(x)) : 64 + __builtin_ctzll(uint64_t(x >> 64));
+}
+
+template<typename C> constexpr C low_bits(int n)
+{
+  return n == 8 * sizeof(C) ? ~C{0} : (C{1} << n) - 1;
+}
+
+// column[k][n] = C(n, k), increasing in n.
+template<int N, int K> struct Binomial_table
+{
+  constexpr Binomial_table() : column{}
+  {
+    for (int k = 0; k <= K; ++k)
+      for (int n = 0; n <= N; ++n)
+        column[k][n] = binomial(n, k);
+  }
+  uint64_t column[K + 1][N + 1];
+};
+
+template<int N, int K> constexpr Binomial_table<N, K> binomials{};
+
+template<typename L> uint64_t rank_combination(typename L::Combination p)
+{
+  uint64_t rank = 0;
+  for (int k = 1; k <= L::K; ++k) {
+    rank += binomials<L::N, L::K>.column[k][lowest_bit(p)];
+    p &= p - 1;
+  }
+  return rank;
+}
+
+template<typename L> typename L::Combination unrank_combination(uint64_t rank)
+{
+  typedef typename L::Combination Combination;
+  Combination p = 0;
+  int top = L::N;
+  for (int k = L::K; k >= 1; --k) {
+    const uint64_t* c = binomials<L::N, L::K>.column[k];
+    int x = std::upper_bound(c + k - 1, c + top, rank) - c - 1;
+    p |= Combination{1} << x;
+    rank -= c[x];
+    top = x;
+  }
+  return p;
+}
+
+// Next combination in colex order (Gosper's hack). The
+// division by the lowest bit is done as a shift, which
+// keeps it cheap for two word masks.
+template<typename C> constexpr C next_combination(C a)
+{
+  C c = a & -a;
+  C r = a + c;
+  return (((r ^ a) >> 2) >> lowest_bit(c)) | r;
+}
+
+// Combinations are equivalent if they have at least T bits
+// in common. We use an unrolled variation of Kernighan's
+// popcount algorithm, cut short after T - 1 steps since we
+// don't need the full popcount. T is a compile-time
+// constant, so the loop unrolls.
+template<typename L>
+bool equivalent(typename L::Combination a, typename L::Combination b)
+{
+  typename L::Combination n{a & b};
+  for (int i = 1; i < L::T; ++i)
+    n = n & (n - 1);
+  return n != 0;
+}
+
+template<typename L> std::bitset<L::N> to_bitset(typename L::Combination x)
+{
+  std::bitset<L::N> b(uint64_t(x & low_bits<typename L::Combination>(64)));
+  if (L::N > 64)
+    b |= std::bitset<L::N>(uint64_t(x >> (L::N > 64 ? 64 : 0))) << 64;
+  return b;
+}
+
+/*
+
+Colex_range.
+
+The combinations with ranks first, ..., last - 1, made one
+at a time by Gosper's hack. Works with range-based for:
+
+  for (auto a : Colex_range<L>(first, last)) ...
+
+*/
+
+template<typename L> class Colex_range
+{
+public:
+  typedef typename L::Combination Combination;
+  class iterator
+  {
+  public:
+    iterator(uint64_t rank, Combination a) : rank{rank}, a{a} {}
+    Combination operator*() const { return a; }
+    iterator& operator++() { ++rank; a = next_combination(a); return *this; }
+    bool operator!=(const iterator& rhs) const { return rank != rhs.rank; }
+    uint64_t index() const { return rank; }
+  private:
+    uint64_t rank;
+    Combination a;
+  };
+  Colex_range(uint64_t first, uint64_t last) : first{first}, last{last} {}
+  iterator begin() const { return iterator(first, unrank_combination<L>(first)); }
+  iterator end() const { return iterator(last, 0); }
+private:
+  uint64_t first;
+  uint64_t last;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef COVER_H
+#define COVER_H
+
+#include <array>
+#include "combination.h"
+
+/*
+
+Neighbourhoods.
+
+The neighbourhood of a ticket t is the set of draws sharing
+at least T numbers with it, the draws t covers. It has
+
+  sum over j >= T of C(K, j) * C(N - K, K - j)
+
+members, 260624 for the Amir problem:
+
+  20 * C(43,3) + 15 * C(43,2) + 6 * 43 + 1
+
+They are made by taking each subset s of t with j >= T
+numbers and filling it up to K from the N - K numbers not
+in t. Per-draw arrays are indexed by the draw's rank.
+
+*/
+
+template<typename L> constexpr uint64_t neighbourhood_size()
+{
+  uint64_t size = 0;
+  for (int j = L::T; j <= L::K; ++j)
+    size += binomial(L::K, j) * binomial(L::N - L::K, L::K - j);
+  return size;
+}
+
+// Calls f with the rank and mask of draws that share at
+// least T numbers with t, until f returns true. Returns
+// whether it did.
+template<typename L, typename F>
+bool any_neighbour(typename L::Combination t, F f)
+{
+  typedef typename L::Combination Combination;
+  const int M = L::N - L::K;
+  typedef Mask<M + 1> Index;
+
+  std::array<Combination, M> other;
+  Combination rest = ~t & low_bits<Combination>(L::N);
+  for (int i = 0; i < M; ++i) {
+    other[i] = rest & -rest;
+    rest &= rest - 1;
+  }
+
+  for (Combination s = t; s != 0; s = (s - 1) & t) {
+    int r = L::K - popcount(s);
+    if (r > L::K - L::T)
+      continue;
+    if (r == 0) {
+      if (f(rank_combination<L>(s), s))
+        return true;
+      continue;
+    }
+    // r of the other numbers, by Gosper's hack on indices.
+    for (Index m = low_bits<Index>(r); (m >> M) == 0; m = next_combination(m)) {
+      Combination d = s;
+      for (Index n = m; n != 0; n &= n - 1)
+        d |= other[lowest_bit(n)];
+      if (f(rank_combination<L>(d), d))
+        return true;
+    }
+  }
+  return false;
+}
+
+// Calls f with the rank and mask of every draw that shares
+// at least T numbers with t.
+template<typename L, typename F>
+void for_each_neighbour(typename L::Combination t, F f)
+{
+  any_neighbour<L>(t, [&](uint64_t d, typename L::Combination m) {
+    f(d, m);
+    return false;
+  });
+}
+
+#endif
@@ -0,0 +1,354 @@
+#ifndef EXACT_H
+#define EXACT_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "combination.h"
+#include "cover.h"
+
+/*
+
+Exact solver.
+
+Smallest Amir sets for lotteries small enough to hold a
+bitmap of every ticket's neighbourhood, C(20,6) = 38760
+combinations at most. Covering is symmetric, t covers d
+exactly when d covers t, so row d of the table is both the
+draws ticket d covers and the tickets that cover draw d.
+
+The search tries sizes m = 1, 2, ... and proves each one too
+small until a cover turns up, so the first cover found is
+minimal. A node holds the draws still uncovered. Some ticket
+has to cover the first of them, u, so the node branches on
+the tickets in row u, the best gains first. Once a branch
+is done its ticket is forbidden in its later siblings:
+every cover containing it has been looked at already.
+
+A node is cut when even the best tickets cannot finish the
+job: the uncovered draws outnumber the best gain among u's
+tickets plus a full neighbourhood for each ticket after
+that. All tickets are alike under relabelling, so the first
+one is fixed as {0, ..., K-1}, and the second is tried once
+per class of relabellings that fix the first. The nodes
+below those are expanded up front, and their subtrees, one
+per third ticket, are handed to the threads from a shared
+counter. That gives thousands of tasks rather than a few
+very uneven ones. The first thread to find a cover stops
+the others.
+
+*/
+
+template<typename L> class Exact_solver
+{
+public:
+  typedef typename L::Combination Combination;
+  static const uint64_t max_combinations = 40000;
+  struct Round
+  {
+    int size;
+    long nodes;
+    bool found;
+  };
+
+  Exact_solver();
+  // A smallest Amir set. rounds gets one entry per size tried.
+  std::vector<Combination> solve(int num_threads, std::vector<Round>& rounds);
+
+private:
+  typedef std::vector<uint64_t> Bitset;
+  // A node below the first tickets, with the tickets it
+  // branches on when the search is split there.
+  struct Subtree
+  {
+    std::vector<uint32_t> chosen;
+    Bitset forbidden;
+    Bitset uncovered;
+    std::vector<uint32_t> tickets;
+  };
+  const uint64_t* row(uint32_t t) const { return &table[t * words]; }
+  bool search(const Bitset& uncovered, int left, Bitset& forbidden,
+              std::vector<uint32_t>& chosen, long& nodes) const;
+  std::vector<uint32_t> branches(const Bitset& uncovered, const Bitset& forbidden,
+                                 uint64_t& best_gain) const;
+  bool expand(Subtree& t, int left, std::atomic<long>& nodes) const;
+  bool last_ticket(const Bitset& uncovered, const Bitset& forbidden,
+                   std::vector<uint32_t>& chosen) const;
+  std::vector<int> classes(uint32_t u, const std::vector<uint32_t>& top) const;
+  uint32_t first_uncovered(const Bitset& uncovered) const;
+
+  std::size_t words;
+  std::vector<uint64_t> table;
+  std::atomic<bool> done{false};
+};
+
+template<typename L> Exact_solver<L>::Exact_solver()
+{
+  if (L::num_combinations > max_combinations)
+    throw std::runtime_error("the exact solver needs at most "
+                             + std::to_string(max_combinations) + " combinations");
+  words = (L::num_combinations + 63) / 64;
+  table.assign(L::num_combinations * words, 0);
+  Colex_range<L> all(0, L::num_combinations);
+  for (auto it = all.begin(); it != all.end(); ++it) {
+    uint64_t* r = &table[it.index() * words];
+    for_each_neighbour<L>(*it, [&](uint64_t d, Combination) { r[d / 64] |= uint64_t{1} << (d % 64); });
+  }
+}
+
+template<typename L> uint32_t Exact_solver<L>::first_uncovered(const Bitset& uncovered) const
+{
+  std::size_t w = 0;
+  while (uncovered[w] == 0)
+    ++w;
+  return 64 * w + lowest_bit(uncovered[w]);
+}
+
+// Tickets covering the first uncovered draw that are not
+// forbidden, best gain first.
+template<typename L>
+std::vector<uint32_t> Exact_solver<L>::branches(const Bitset& uncovered, const Bitset& forbidden,
+                                                uint64_t& best_gain) const
+{
+  std::size_t first = first_uncovered(uncovered) / 64;
+  const uint64_t* u = row(first_uncovered(uncovered));
+
+  std::vector<std::pair<uint64_t, uint32_t>> gains;
+  for (std::size_t w = 0; w < words; ++w)
+    for (uint64_t b = u[w] & ~forbidden[w]; b != 0; b &= b - 1) {
+      uint32_t t = 64 * w + lowest_bit(b);
+      const uint64_t* r = row(t);
+      uint64_t gain = 0;
+      for (std::size_t i = first; i < words; ++i)
+        gain += popcount(r[i] & uncovered[i]);
+      gains.emplace_back(gain, t);
+    }
+  std::sort(gains.begin(), gains.end(),
+            [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+              return a.first > b.first;
+            });
+  best_gain = gains.empty() ? 0 : gains[0].first;
+  std::vector<uint32_t> result;
+  for (auto& g : gains)
+    result.push_back(g.second);
+  return result;
+}
+
+// With one ticket to go there are no gains to sort: it has
+// to cover everything that is left.
+template<typename L>
+bool Exact_solver<L>::last_ticket(const Bitset& uncovered, const Bitset& forbidden,
+                                  std::vector<uint32_t>& chosen) const
+{
+  std::size_t first = first_uncovered(uncovered) / 64;
+  const uint64_t* u = row(first_uncovered(uncovered));
+  for (std::size_t w = 0; w < words; ++w)
+    for (uint64_t b = u[w] & ~forbidden[w]; b != 0; b &= b - 1) {
+      uint32_t t = 64 * w + lowest_bit(b);
+      const uint64_t* r = row(t);
+      std::size_t i = first;
+      while (i < words && (uncovered[i] & ~r[i]) == 0)
+        ++i;
+      if (i == words) {
+        chosen.push_back(t);
+        return true;
+      }
+    }
+  return false;
+}
+
+// Relabellings that fix the first ticket A and the draw u
+// can take a ticket to any other with as many numbers in
+// each of A and u, A only, u only and neither. Classes are
+// numbered in the order their first ticket appears in top.
+template<typename L>
+std::vector<int> Exact_solver<L>::classes(uint32_t u, const std::vector<uint32_t>& top) const
+{
+  Combination a = unrank_combination<L>(0);
+  Combination d = unrank_combination<L>(u);
+  Combination region[4] = {a & d, a & ~d, ~a & d, ~a & ~d};
+  std::vector<int> key_class((L::K + 1) * (L::K + 1) * (L::K + 1), -1);
+  std::vector<int> result;
+  int num_classes = 0;
+  for (auto t : top) {
+    Combination x = unrank_combination<L>(t);
+    int key = 0;
+    for (int r = 0; r < 3; ++r)
+      key = (L::K + 1) * key + popcount(x & region[r]);
+    if (key_class[key] < 0)
+      key_class[key] = num_classes++;
+    result.push_back(key_class[key]);
+  }
+  return result;
+}
+
+template<typename L>
+bool Exact_solver<L>::search(const Bitset& uncovered, int left, Bitset& forbidden,
+                             std::vector<uint32_t>& chosen, long& nodes) const
+{
+  nodes++;
+  uint64_t count = 0;
+  for (auto w : uncovered)
+    count += popcount(w);
+  if (count == 0)
+    return true;
+  if (left == 0 || done)
+    return false;
+  if (count > left * neighbourhood_size<L>())
+    return false;
+  if (left == 1)
+    return last_ticket(uncovered, forbidden, chosen);
+
+  uint64_t best_gain;
+  std::vector<uint32_t> tickets = branches(uncovered, forbidden, best_gain);
+  if (count > best_gain + (left - 1) * neighbourhood_size<L>())
+    return false;
+
+  Bitset next(words);
+  bool found = false;
+  std::size_t i = 0;
+  for (; i < tickets.size() && !found; ++i) {
+    const uint64_t* r = row(tickets[i]);
+    for (std::size_t w = 0; w < words; ++w)
+      next[w] = uncovered[w] & ~r[w];
+    chosen.push_back(tickets[i]);
+    found = search(next, left - 1, forbidden, chosen, nodes);
+    if (!found) {
+      chosen.pop_back();
+      forbidden[tickets[i] / 64] |= uint64_t{1} << (tickets[i] % 64);
+    }
+  }
+  for (std::size_t j = 0; j < i; ++j)
+    forbidden[tickets[j] / 64] &= ~(uint64_t{1} << (tickets[j] % 64));
+  return found;
+}
+
+// What search does at a node with two or more tickets to
+// go before it branches. False if the node is cut.
+template<typename L>
+bool Exact_solver<L>::expand(Subtree& t, int left, std::atomic<long>& nodes) const
+{
+  nodes++;
+  uint64_t count = 0;
+  for (auto w : t.uncovered)
+    count += popcount(w);
+  if (count == 0)
+    return true;
+  if (count > left * neighbourhood_size<L>())
+    return false;
+  uint64_t best_gain;
+  t.tickets = branches(t.uncovered, t.forbidden, best_gain);
+  return count <= best_gain + (left - 1) * neighbourhood_size<L>();
+}
+
+template<typename L>
+std::vector<typename L::Combination> Exact_solver<L>::solve(int num_threads,
+                                                            std::vector<Round>& rounds)
+{
+  // The first ticket, rank 0, is {0, ..., K-1}.
+  Bitset all(words, ~uint64_t{0});
+  if (L::num_combinations % 64)
+    all[words - 1] = low_bits<uint64_t>(L::num_combinations % 64);
+  Bitset uncovered(words);
+  for (std::size_t w = 0; w < words; ++w)
+    uncovered[w] = all[w] & ~row(0)[w];
+
+  std::vector<uint32_t> solution;
+  for (int m = 1; solution.empty(); ++m) {
+    Round round{m, 1, false};
+    if (std::all_of(uncovered.begin(), uncovered.end(), [](uint64_t w) { return w == 0; })) {
+      solution.push_back(0);
+      round.found = true;
+      rounds.push_back(round);
+      break;
+    }
+    if (m == 1) {
+      rounds.push_back(round);
+      continue;
+    }
+
+    Bitset none(words, 0);
+    uint64_t best_gain;
+    std::vector<uint32_t> top = branches(uncovered, none, best_gain);
+    std::vector<int> class_of = classes(first_uncovered(uncovered), top);
+    std::atomic<long> nodes{1};
+    done = false;
+
+    // One second ticket per class, the earlier classes
+    // forbidden. With at least two tickets to go each of
+    // these nodes is expanded here, so the threads get one
+    // task per third ticket instead of a few uneven subtrees.
+    std::vector<Subtree> subtrees;
+    int seen = 0;
+    for (std::size_t i = 0; i < top.size(); ++i) {
+      if (class_of[i] != seen)
+        continue;
+      ++seen;
+      Subtree t{{0, top[i]}, Bitset(words, 0), Bitset(words), {}};
+      for (std::size_t j = 0; j < top.size(); ++j)
+        if (class_of[j] < class_of[i])
+          t.forbidden[top[j] / 64] |= uint64_t{1} << (top[j] % 64);
+      const uint64_t* r = row(top[i]);
+      for (std::size_t w = 0; w < words; ++w)
+        t.uncovered[w] = uncovered[w] & ~r[w];
+      if (m - 2 >= 2 && !expand(t, m - 2, nodes))
+        continue;
+      subtrees.push_back(t);
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> tasks;
+    for (std::size_t i = 0; i < subtrees.size(); ++i)
+      if (m - 2 < 2 || subtrees[i].tickets.empty())
+        tasks.emplace_back(i, 0);
+      else
+        for (std::size_t j = 0; j < subtrees[i].tickets.size(); ++j)
+          tasks.emplace_back(i, j);
+    std::atomic<std::size_t> next_task{0};
+
+    auto work = [&]() {
+      Bitset forbidden(words);
+      Bitset next(words);
+      long n = 0;
+      std::size_t k;
+      while (!done && (k = next_task++) < tasks.size()) {
+        const Subtree& t = subtrees[tasks[k].first];
+        std::size_t j = tasks[k].second;
+        std::vector<uint32_t> chosen = t.chosen;
+        int left = m - chosen.size();
+        forbidden = t.forbidden;
+        if (t.tickets.empty()) {
+          next = t.uncovered;
+        } else {
+          // The third tickets before j are done with.
+          for (std::size_t i = 0; i < j; ++i)
+            forbidden[t.tickets[i] / 64] |= uint64_t{1} << (t.tickets[i] % 64);
+          const uint64_t* r = row(t.tickets[j]);
+          for (std::size_t w = 0; w < words; ++w)
+            next[w] = t.uncovered[w] & ~r[w];
+          chosen.push_back(t.tickets[j]);
+          --left;
+        }
+        if (search(next, left, forbidden, chosen, n) && !done.exchange(true))
+          solution = chosen;
+      }
+      nodes += n;
+    };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; t++)
+      workers.emplace_back(work);
+    for (auto& w : workers)
+      w.join();
+
+    round.nodes = nodes;
+    round.found = !solution.empty();
+    rounds.push_back(round);
+  }
+
+  std::vector<Combination> result;
+  for (auto t : solution)
+    result.push_back(unrank_combination<L>(t));
+  return result;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <immintrin.h>
+#include "combination.h"
+
+/*
+
+Batched equivalence kernels.
+
+The same Kernighan trick works lane by lane in a vector
+register: AND the candidate with 4 (AVX2) or 8 (AVX-512)
+members, clear the T - 1 lowest bits of each lane, and test
+whether anything is left. That is the popcount >= T
+threshold without computing a popcount.
+
+The members live in a contiguous 64-byte aligned array
+padded with zeros to a multiple of 8. A zero member is
+never equivalent to anything, so the kernels can always
+read whole vectors.
+
+The widest kernel the cpu supports is picked at runtime.
+Vector kernels exist for one word masks only. Two word
+masks (N > 64) always use the scalar loop.
+
+*/
+
+template<typename C> using Batch_kernel = bool (*)(const C*, std::size_t, C);
+
+template<typename L>
+bool any_equivalent_scalar(const typename L::Combination* m, std::size_t n,
+                           typename L::Combination p)
+{
+  for (std::size_t i = 0; i < n; ++i)
+    if (equivalent<L>(m[i], p))
+      return true;
+  return false;
+}
+
+template<int T> __attribute__((target("avx2")))
+bool any_equivalent_avx2(const uint64_t* m, std::size_t n, uint64_t p)
+{
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i q = _mm256_set1_epi64x(p);
+  for (std::size_t i = 0; i < n; i += 8) {
+    __m256i x = _mm256_and_si256(_mm256_load_si256((const __m256i*)(m + i)), q);
+    __m256i y = _mm256_and_si256(_mm256_load_si256((const __m256i*)(m + i + 4)), q);
+    for (int j = 1; j < T; ++j) {
+      x = _mm256_and_si256(x, _mm256_sub_epi64(x, one));
+      y = _mm256_and_si256(y, _mm256_sub_epi64(y, one));
+    }
+    x = _mm256_or_si256(x, y);
+    if (!_mm256_testz_si256(x, x))
+      return true;
+  }
+  return false;
+}
+
+template<int T> __attribute__((target("avx512f")))
+bool any_equivalent_avx512(const uint64_t* m, std::size_t n, uint64_t p)
+{
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i q = _mm512_set1_epi64(p);
+  for (std::size_t i = 0; i < n; i += 8) {
+    __m512i x = _mm512_and_si512(_mm512_load_si512(m + i), q);
+    for (int j = 1; j < T; ++j)
+      x = _mm512_and_si512(x, _mm512_sub_epi64(x, one));
+    if (_mm512_test_epi64_mask(x, x))
+      return true;
+  }
+  return false;
+}
+
+/*
+
+Overlap kernels.
+
+For each draw the verifier wants the best match: the
+largest number of bits it has in common with any member.
+
+Overlap counts are vectorized with the nibble lookup
+popcount: split each byte into two nibbles, look up their
+popcounts with a byte shuffle, and add the bytes of each
+64-bit lane with a sum of absolute differences against 0.
+
+*/
+
+template<typename C> using Overlap_kernel = int (*)(const C*, std::size_t, C);
+
+template<typename C>
+int best_overlap_scalar(const C* m, std::size_t n, C d)
+{
+  int best = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    best = std::max(best, popcount(m[i] & d));
+  return best;
+}
+
+__attribute__((target("avx2")))
+inline int best_overlap_avx2(const uint64_t* m, std::size_t n, uint64_t d)
+{
+  const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  const __m256i q = _mm256_set1_epi64x(d);
+  __m256i best = _mm256_setzero_si256();
+  for (std::size_t i = 0; i < n; i += 4) {
+    __m256i x = _mm256_and_si256(_mm256_load_si256((const __m256i*)(m + i)), q);
+    __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, low));
+    __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+    __m256i count = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+    best = _mm256_max_epi32(best, count);
+  }
+  alignas(32) uint64_t lane[4];
+  _mm256_store_si256((__m256i*)lane, best);
+  return std::max(std::max(lane[0], lane[1]), std::max(lane[2], lane[3]));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline int best_overlap_avx512(const uint64_t* m, std::size_t n, uint64_t d)
+{
+  const __m512i table = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+  const __m512i low = _mm512_set1_epi8(0x0f);
+  const __m512i q = _mm512_set1_epi64(d);
+  __m512i best = _mm512_setzero_si512();
+  for (std::size_t i = 0; i < n; i += 8) {
+    __m512i x = _mm512_and_si512(_mm512_load_si512(m + i), q);
+    __m512i lo = _mm512_shuffle_epi8(table, _mm512_and_si512(x, low));
+    __m512i hi = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(x, 4), low));
+    __m512i count = _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+    best = _mm512_max_epu64(best, count);
+  }
+  return _mm512_reduce_max_epu64(best);
+}
+
+// Name of the widest instruction set this cpu supports.
+inline std::string best_isa()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return "avx512";
+  if (__builtin_cpu_supports("avx2")) return "avx2";
+  return "scalar";
+}
+
+// Instruction sets from narrowest to widest, -1 for names
+// we don't know.
+inline int isa_rank(const std::string& isa)
+{
+  if (isa == "scalar") return 0;
+  if (isa == "avx2") return 1;
+  if (isa == "avx512") return 2;
+  return -1;
+}
+
+template<typename L, typename C = typename L::Combination> struct Kernels
+{
+  static Batch_kernel<C> equivalence(const std::string&)
+  {
+    return any_equivalent_scalar<L>;
+  }
+  static Overlap_kernel<C> overlap(const std::string&)
+  {
+    return best_overlap_scalar<C>;
+  }
+};
+
+template<typename L> struct Kernels<L, uint64_t>
+{
+  static Batch_kernel<uint64_t> equivalence(const std::string& isa)
+  {
+    if (isa == "avx512") return any_equivalent_avx512<L::T>;
+    if (isa == "avx2") return any_equivalent_avx2<L::T>;
+    return any_equivalent_scalar<L>;
+  }
+  static Overlap_kernel<uint64_t> overlap(const std::string& isa)
+  {
+    if (isa == "avx512") return best_overlap_avx512;
+    if (isa == "avx2") return best_overlap_avx2;
+    return best_overlap_scalar<uint64_t>;
+  }
+};
+
+// Contiguous, aligned, zero-padded copy of an Amir set.
+template<typename C> class Member_array
+{
+public:
+  Member_array() : data{nullptr}, size{0}, capacity{0} {}
+  ~Member_array() { std::free(data); }
+  Member_array(const Member_array&) = delete;
+  Member_array& operator=(const Member_array&) = delete;
+  void push_back(C p);
+  const C* begin() const { return data; }
+  // Number of slots the kernels scan, a multiple of 8.
+  std::size_t padded_size() const { return (size + 7) & ~std::size_t{7}; }
+private:
+  C* data;
+  std::size_t size;
+  std::size_t capacity;
+};
+
+template<typename C> void Member_array<C>::push_back(C p)
+{
+  if (size == capacity) {
+    std::size_t new_capacity = capacity == 0 ? 256 : 2 * capacity;
+    C* new_data = static_cast<C*>(aligned_alloc(64, new_capacity * sizeof(C)));
+    std::fill(new_data, new_data + new_capacity, 0);
+    std::copy(data, data + size, new_data);
+    std::free(data);
+    data = new_data;
+    capacity = new_capacity;
+  }
+  data[size++] = p;
+}
+
+#endif
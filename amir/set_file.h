@@ -0,0 +1,244 @@
+#ifndef SET_FILE_H
+#define SET_FILE_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "combination.h"
+
+/*
+
+Amir set files.
+
+Text files have one bitset line per member, label 0 on the
+right. The program prints N characters, the stored sets of
+the original search have 64.
+
+Binary files are a 64-byte header followed by the masks,
+one uint64_t each for N <= 64 and two (low word first)
+above that, in native byte order:
+
+  magic     "AMIRSET" and a zero byte
+  n, k, t   the lottery, uint32_t each
+  words     uint64_t words per mask, uint32_t
+  size      number of members, uint64_t
+  position  colex ranks swept so far, uint64_t
+  width     characters per line in text form, uint32_t
+
+A finished set has position C(N,K). A checkpoint of an
+interrupted sweep has the number of combinations it had
+looked at, and the set it had found so far. Binary files
+are mapped with mmap and the masks are read in place.
+
+Both formats hold exactly the masks, and the binary one
+remembers the line width, so converting a text file to
+binary and back gives the same file. Text has no position:
+it always reads back as a finished set.
+
+*/
+
+template<typename L> using Amir_set = std::vector<typename L::Combination>;
+
+struct Set_header
+{
+  char magic[8];
+  uint32_t n, k, t;
+  uint32_t words;
+  uint64_t size;
+  uint64_t position;
+  uint32_t width;
+  uint32_t unused;
+  uint64_t reserved[2];
+};
+
+static_assert(sizeof(Set_header) == 64, "set file header is 64 bytes");
+
+const char set_magic[8] = "AMIRSET";
+
+// A set together with how far the sweep that made it got,
+// and how wide its text lines are.
+template<typename L> struct Sweep_state
+{
+  Amir_set<L> amir;
+  uint64_t position{L::num_combinations};
+  int width{L::N};
+};
+
+// Lines that are not made of 0s and 1s are skipped, so the
+// output of this program can be read back in directly. The
+// width of the first member's line is kept in width.
+template<typename L> Amir_set<L> read_amir_set(std::istream& in, int* width = nullptr)
+{
+  Amir_set<L> result;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.size() > 128
+        || line.find_first_not_of("01") != std::string::npos)
+      continue;
+    uint128_t p = 0;
+    for (char c : line)
+      p = (p << 1) | (c == '1');
+    if (popcount(p) != L::K || (p & ~low_bits<uint128_t>(L::N)) != 0)
+      throw std::runtime_error("not a " + std::to_string(L::K) + " of "
+                               + std::to_string(L::N) + " combination: " + line);
+    if (width && result.empty())
+      *width = std::max<int>(L::N, line.size());
+    result.push_back(typename L::Combination(p));
+  }
+  return result;
+}
+
+// Read-only mapping of a whole file.
+class Mapped_file
+{
+public:
+  explicit Mapped_file(const std::string& filename);
+  ~Mapped_file() { if (size > 0) munmap(data, size); }
+  Mapped_file(const Mapped_file&) = delete;
+  Mapped_file& operator=(const Mapped_file&) = delete;
+  const char* begin() const { return static_cast<const char*>(data); }
+  std::size_t length() const { return size; }
+private:
+  void* data{nullptr};
+  std::size_t size{0};
+};
+
+inline Mapped_file::Mapped_file(const std::string& filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("cannot open " + filename);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    size = st.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED)
+    throw std::runtime_error("cannot map " + filename);
+}
+
+inline bool is_binary_set_file(const std::string& filename)
+{
+  char magic[8] = {0};
+  std::ifstream in(filename, std::ios::binary);
+  in.read(magic, sizeof magic);
+  return in && std::memcmp(magic, set_magic, sizeof magic) == 0;
+}
+
+template<typename L> Sweep_state<L> read_binary_set(const std::string& filename)
+{
+  typedef typename L::Combination Combination;
+  const uint32_t words = sizeof(Combination) / 8;
+  Mapped_file file(filename);
+  Set_header h;
+  if (file.length() < sizeof h)
+    throw std::runtime_error(filename + ": truncated header");
+  std::memcpy(&h, file.begin(), sizeof h);
+  if (std::memcmp(h.magic, set_magic, sizeof h.magic) != 0)
+    throw std::runtime_error(filename + ": not an Amir set file");
+  if (h.n != L::N || h.k != L::K || h.t != L::T || h.words != words)
+    throw std::runtime_error(filename + ": holds a " + std::to_string(h.k) + "/"
+                             + std::to_string(h.n) + " match " + std::to_string(h.t) + " set");
+  // Size checked against the length by division first: a
+  // huge size would wrap the product.
+  if (h.size > (file.length() - sizeof h) / (8 * words)
+      || file.length() != sizeof h + h.size * words * 8 || h.position > L::num_combinations
+      || h.width > 128)
+    throw std::runtime_error(filename + ": bad size");
+
+  Sweep_state<L> state;
+  state.position = h.position;
+  state.width = std::max<int>(L::N, h.width);
+  const uint64_t* mask = reinterpret_cast<const uint64_t*>(file.begin() + sizeof h);
+  for (uint64_t i = 0; i < h.size; ++i) {
+    Combination p{mask[words * i]};
+    if (words == 2)
+      p |= Combination(mask[2 * i + 1]) << (words == 2 ? 64 : 0);
+    if (popcount(p) != L::K || (p & ~low_bits<Combination>(L::N)) != 0)
+      throw std::runtime_error(filename + ": bad mask at member " + std::to_string(i));
+    state.amir.push_back(p);
+  }
+  return state;
+}
+
+// Written to a temporary file first and renamed, so an
+// interrupted write never replaces a good file.
+template<typename L>
+void write_binary_set(const std::string& filename, const Amir_set<L>& amir,
+                      uint64_t position = L::num_combinations, int width = L::N)
+{
+  typedef typename L::Combination Combination;
+  const uint32_t words = sizeof(Combination) / 8;
+  Set_header h{};
+  std::memcpy(h.magic, set_magic, sizeof h.magic);
+  h.n = L::N;
+  h.k = L::K;
+  h.t = L::T;
+  h.words = words;
+  h.size = amir.size();
+  h.position = position;
+  h.width = width;
+
+  std::vector<uint64_t> mask;
+  for (auto p : amir) {
+    mask.push_back(uint64_t(p));
+    if (words == 2)
+      mask.push_back(uint64_t(p >> (words == 2 ? 64 : 0)));
+  }
+
+  std::string temporary = filename + ".tmp";
+  std::ofstream out(temporary, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(&h), sizeof h);
+  out.write(reinterpret_cast<const char*>(mask.data()), mask.size() * 8);
+  out.close();
+  if (!out)
+    throw std::runtime_error("cannot write " + temporary);
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+    throw std::runtime_error("cannot rename " + temporary);
+}
+
+// Lines wider than N are padded with zeros on the left.
+template<typename L>
+void write_text_set(const std::string& filename, const Amir_set<L>& amir, int width = L::N)
+{
+  std::string temporary = filename + ".tmp";
+  std::ofstream out(temporary);
+  std::string padding(std::max(0, width - L::N), '0');
+  for (auto u : amir)
+    out << padding << to_bitset<L>(u) << std::endl;
+  out.close();
+  if (!out)
+    throw std::runtime_error("cannot write " + temporary);
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+    throw std::runtime_error("cannot rename " + temporary);
+}
+
+// Either format, told apart by the magic.
+template<typename L> Sweep_state<L> load_sweep_state(const std::string& filename)
+{
+  if (is_binary_set_file(filename))
+    return read_binary_set<L>(filename);
+  std::ifstream in(filename);
+  if (!in)
+    throw std::runtime_error("cannot open " + filename);
+  Sweep_state<L> state;
+  state.amir = read_amir_set<L>(in, &state.width);
+  return state;
+}
+
+template<typename L> Amir_set<L> load_amir_set(const std::string& filename)
+{
+  return load_sweep_state<L>(filename).amir;
+}
+
+#endif
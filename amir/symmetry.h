@@ -0,0 +1,178 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <array>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "combination.h"
+
+/*
+
+Permutations of the N labels, applied to whole combinations.
+
+A Permutation keeps one lookup table per byte of the mask:
+entry [b][v] is the image of the bits v in byte b. Applying
+it is one lookup and one OR per byte, 7 for the Amir
+problem, instead of a loop over all 49 bits.
+
+Symmetry groups are subgroups of the affine maps
+
+  i -> a * i + b  (mod N),   gcd(a, N) = 1
+
+Every such map is a multiplication followed by a rotation
+of the N-bit field, so a Symmetry_group keeps a table
+Permutation for each multiplier a it uses, and does the
+rotation with two shifts. The groups on offer:
+
+  none       identity only
+  mirror     i -> N - 1 - i, the original mirror image
+  cyclic     i -> i + b, order N
+  dihedral   i -> +-i + b, order 2N
+  affine     i -> a * i + b, order N * phi(N)
+
+The elements are listed identity first, so orbit() hands
+out a combination itself before any of its images. The
+canonical member of an orbit is its smallest mask.
+
+*/
+
+template<typename L> class Permutation
+{
+public:
+  typedef typename L::Combination Combination;
+  explicit Permutation(const std::array<int, L::N>& image);
+  Combination operator()(Combination x) const
+  {
+    Combination result{0};
+    for (int b = 0; b < num_bytes; ++b)
+      result |= table[b][(x >> (8 * b)) & 0xff];
+    return result;
+  }
+private:
+  static constexpr int num_bytes = (L::N + 7) / 8;
+  std::array<std::array<Combination, 256>, num_bytes> table;
+};
+
+template<typename L>
+Permutation<L>::Permutation(const std::array<int, L::N>& image)
+{
+  for (int b = 0; b < num_bytes; ++b)
+    for (int v = 0; v < 256; ++v) {
+      Combination y{0};
+      for (int i = 0; i < 8; ++i)
+        if ((v >> i & 1) && 8 * b + i < L::N)
+          y |= Combination{1} << image[8 * b + i];
+      table[b][v] = y;
+    }
+}
+
+// i -> a * i (mod N).
+template<typename L> Permutation<L> multiplier(int a)
+{
+  std::array<int, L::N> image;
+  for (int i = 0; i < L::N; ++i)
+    image[i] = (a * i) % L::N;
+  return Permutation<L>(image);
+}
+
+// Bit i moves to bit i + b (mod N).
+template<typename L>
+typename L::Combination rotate(typename L::Combination x, int b)
+{
+  if (b == 0)
+    return x;
+  return ((x << b) | (x >> (L::N - b))) & low_bits<typename L::Combination>(L::N);
+}
+
+template<typename L> class Symmetry_group
+{
+public:
+  typedef typename L::Combination Combination;
+  explicit Symmetry_group(const std::string& name);
+  std::size_t order() const { return elements.size(); }
+  // Whether the group contains all N rotations.
+  bool has_rotations() const { return rotations; }
+  // The image of x under the i-th element.
+  Combination operator()(std::size_t i, Combination x) const
+  {
+    return rotate<L>(multipliers[elements[i].multiplier](x), elements[i].shift);
+  }
+  // Calls f with every image of x, x itself first. Images
+  // repeat when x has symmetries of its own.
+  template<typename F> void orbit(Combination x, F f) const
+  {
+    for (std::size_t i = 0; i < elements.size(); ++i)
+      f((*this)(i, x));
+  }
+  // x is canonical when no image of x is a smaller mask.
+  // Most combinations meet a smaller image within the first
+  // few elements.
+  bool is_canonical(Combination x) const
+  {
+    for (std::size_t i = 1; i < elements.size(); ++i)
+      if ((*this)(i, x) < x)
+        return false;
+    return true;
+  }
+private:
+  struct Element
+  {
+    int multiplier; // index into multipliers.
+    int shift;
+  };
+  void add_multiplier(int a, bool all_shifts);
+  std::vector<Permutation<L>> multipliers;
+  std::vector<Element> elements;
+  bool rotations{false};
+};
+
+template<typename L> void Symmetry_group<L>::add_multiplier(int a, bool all_shifts)
+{
+  int m = multipliers.size();
+  multipliers.push_back(multiplier<L>(a));
+  if (all_shifts)
+    for (int b = 0; b < L::N; ++b)
+      elements.push_back(Element{m, b});
+  else
+    elements.push_back(Element{m, 0});
+}
+
+template<typename L> Symmetry_group<L>::Symmetry_group(const std::string& name)
+{
+  int gcd_table[L::N];
+  for (int a = 1; a < L::N; ++a) {
+    int x = a, y = L::N;
+    while (y != 0) { int r = x % y; x = y; y = r; }
+    gcd_table[a] = x;
+  }
+
+  if (name == "none")
+    add_multiplier(1, false);
+  else if (name == "mirror") {
+    // i -> -i - 1 is multiplication by N - 1, then a
+    // rotation by N - 1.
+    add_multiplier(1, false);
+    multipliers.push_back(multiplier<L>(L::N - 1));
+    elements.push_back(Element{1, L::N - 1});
+  }
+  else if (name == "cyclic") {
+    add_multiplier(1, true);
+    rotations = true;
+  }
+  else if (name == "dihedral") {
+    add_multiplier(1, true);
+    add_multiplier(L::N - 1, true);
+    rotations = true;
+  }
+  else if (name == "affine") {
+    for (int a = 1; a < L::N; ++a)
+      if (gcd_table[a] == 1)
+        add_multiplier(a, true);
+    rotations = true;
+  }
+  else
+    throw std::runtime_error("unknown symmetry group: " + name);
+}
+
+#endif
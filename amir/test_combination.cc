@@ -0,0 +1,74 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Combination
+#include <boost/test/unit_test.hpp>
+#include "combination.h"
+
+typedef Lottery<49, 6, 3> Amir;
+typedef Lottery<35, 5, 3> Small;
+typedef Lottery<80, 7, 3> Wide;
+typedef Lottery<49, 6, 4> Four;
+
+BOOST_AUTO_TEST_SUITE(Ranking)
+
+BOOST_AUTO_TEST_CASE(Binomials)
+{
+  BOOST_CHECK_EQUAL(Amir::num_combinations, 13983816u);
+  BOOST_CHECK_EQUAL(Small::num_combinations, 324632u);
+  BOOST_CHECK_EQUAL(Wide::num_combinations, 3176716400u);
+}
+
+BOOST_AUTO_TEST_CASE(First_and_last)
+{
+  BOOST_CHECK_EQUAL(rank_combination<Amir>(0b111111), 0u);
+  BOOST_CHECK_EQUAL(unrank_combination<Amir>(0), uint64_t{0b111111});
+  uint64_t last = uint64_t{0b111111} << 43;
+  BOOST_CHECK_EQUAL(rank_combination<Amir>(last), Amir::num_combinations - 1);
+  BOOST_CHECK_EQUAL(unrank_combination<Amir>(Amir::num_combinations - 1), last);
+}
+
+BOOST_AUTO_TEST_CASE(Round_trip_in_colex_order)
+{
+  uint64_t rank = 0;
+  for (auto a : Colex_range<Amir>(0, Amir::num_combinations)) {
+    if (rank_combination<Amir>(a) != rank || unrank_combination<Amir>(rank) != a)
+      BOOST_FAIL("round trip failed at rank " << rank);
+    ++rank;
+  }
+  BOOST_CHECK_EQUAL(rank, Amir::num_combinations);
+}
+
+BOOST_AUTO_TEST_CASE(Range_from_the_middle)
+{
+  Colex_range<Amir> r(1000000, 1000010);
+  auto it = r.begin();
+  for (uint64_t i = 1000000; i < 1000010; ++i, ++it) {
+    BOOST_CHECK_EQUAL(it.index(), i);
+    BOOST_CHECK_EQUAL(*it, unrank_combination<Amir>(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Two_word_masks)
+{
+  uint64_t start = Wide::num_combinations - 100000;
+  uint64_t rank = start;
+  for (auto a : Colex_range<Wide>(start, Wide::num_combinations)) {
+    if (popcount(a) != 7 || rank_combination<Wide>(a) != rank)
+      BOOST_FAIL("two word round trip failed at rank " << rank);
+    ++rank;
+  }
+  uint128_t last = uint128_t{0b1111111} << 73;
+  BOOST_CHECK(unrank_combination<Wide>(Wide::num_combinations - 1) == last);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(Matching)
+
+BOOST_AUTO_TEST_CASE(Threshold)
+{
+  BOOST_CHECK(equivalent<Amir>(0b111000111, 0b000111111));
+  BOOST_CHECK(!equivalent<Amir>(0b110000111, 0b001111110));
+  BOOST_CHECK(!equivalent<Four>(0b111000111, 0b000111111));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Exact
+#include <boost/test/unit_test.hpp>
+#include "exact.h"
+
+typedef Lottery<8, 3, 2> Tiny;
+typedef Lottery<9, 4, 2> Small;
+typedef Lottery<12, 6, 3> Halves;
+typedef Lottery<21, 6, 3> Large;
+
+template<typename L> bool covers_everything(const std::vector<typename L::Combination>& set)
+{
+  for (auto d : Colex_range<L>(0, L::num_combinations)) {
+    bool covered = false;
+    for (auto t : set)
+      covered = covered || equivalent<L>(t, d);
+    if (!covered)
+      return false;
+  }
+  return true;
+}
+
+// Tries every set of m tickets with ranks from first on.
+template<typename L>
+bool some_cover(int m, uint64_t first, std::vector<typename L::Combination>& set)
+{
+  if (m == 0)
+    return covers_everything<L>(set);
+  for (uint64_t t = first; t < L::num_combinations; ++t) {
+    set.push_back(unrank_combination<L>(t));
+    bool found = some_cover<L>(m - 1, t + 1, set);
+    set.pop_back();
+    if (found)
+      return true;
+  }
+  return false;
+}
+
+template<typename L> void check_minimal()
+{
+  Exact_solver<L> solver;
+  std::vector<typename Exact_solver<L>::Round> rounds;
+  auto set = solver.solve(2, rounds);
+  BOOST_CHECK(covers_everything<L>(set));
+  BOOST_CHECK_EQUAL(rounds.back().size, int(set.size()));
+  BOOST_CHECK(rounds.back().found);
+  std::vector<typename L::Combination> smaller;
+  BOOST_CHECK(!some_cover<L>(set.size() - 1, 0, smaller));
+}
+
+BOOST_AUTO_TEST_SUITE(Exact)
+
+BOOST_AUTO_TEST_CASE(Minimal_by_brute_force)
+{
+  check_minimal<Tiny>();
+  check_minimal<Small>();
+}
+
+BOOST_AUTO_TEST_CASE(Two_halves)
+{
+  // Any 6 of 12 has 3 in one of two disjoint tickets, and
+  // one ticket is not enough.
+  Exact_solver<Halves> solver;
+  std::vector<Exact_solver<Halves>::Round> rounds;
+  auto set = solver.solve(1, rounds);
+  BOOST_CHECK_EQUAL(set.size(), 2u);
+  check_minimal<Halves>();
+}
+
+BOOST_AUTO_TEST_CASE(Too_large)
+{
+  BOOST_CHECK_THROW(Exact_solver<Large>(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Set_file
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include "set_file.h"
+
+typedef Lottery<49, 6, 3> Amir;
+typedef Lottery<80, 7, 3> Wide;
+
+std::string contents(const std::string& filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  std::ostringstream out;
+  out << in.rdbuf();
+  return out.str();
+}
+
+template<typename L> Amir_set<L> some_members(int n)
+{
+  Amir_set<L> amir;
+  for (int i = 0; i < n; ++i)
+    amir.push_back(unrank_combination<L>((L::num_combinations / n) * i + i));
+  return amir;
+}
+
+BOOST_AUTO_TEST_SUITE(Set_file)
+
+BOOST_AUTO_TEST_CASE(Text_to_binary_and_back)
+{
+  // Lines of 64 characters, like the stored sets.
+  Amir_set<Amir> amir = some_members<Amir>(241);
+  write_text_set<Amir>("test_set_file.txt", amir, 64);
+  Sweep_state<Amir> text = load_sweep_state<Amir>("test_set_file.txt");
+  BOOST_CHECK_EQUAL(text.width, 64);
+  write_binary_set<Amir>("test_set_file.bin", text.amir, text.position, text.width);
+  BOOST_CHECK(is_binary_set_file("test_set_file.bin"));
+  Sweep_state<Amir> binary = load_sweep_state<Amir>("test_set_file.bin");
+  BOOST_CHECK(binary.amir == amir);
+  write_text_set<Amir>("test_set_file.copy", binary.amir, binary.width);
+  BOOST_CHECK(contents("test_set_file.copy") == contents("test_set_file.txt"));
+  std::remove("test_set_file.txt");
+  std::remove("test_set_file.bin");
+  std::remove("test_set_file.copy");
+}
+
+BOOST_AUTO_TEST_CASE(Two_word_masks)
+{
+  Amir_set<Wide> amir = some_members<Wide>(100);
+  write_binary_set<Wide>("test_set_file.bin", amir);
+  BOOST_CHECK(load_amir_set<Wide>("test_set_file.bin") == amir);
+  std::remove("test_set_file.bin");
+}
+
+BOOST_AUTO_TEST_CASE(Checkpoint_position)
+{
+  Amir_set<Amir> amir = some_members<Amir>(50);
+  write_binary_set<Amir>("test_set_file.bin", amir, 123456);
+  Sweep_state<Amir> state = load_sweep_state<Amir>("test_set_file.bin");
+  BOOST_CHECK_EQUAL(state.position, 123456u);
+  BOOST_CHECK(state.amir == amir);
+  std::remove("test_set_file.bin");
+}
+
+BOOST_AUTO_TEST_CASE(Bad_headers)
+{
+  write_binary_set<Amir>("test_set_file.bin", some_members<Amir>(1));
+  BOOST_CHECK_THROW(load_sweep_state<Wide>("test_set_file.bin"), std::runtime_error);
+
+  // A size whose byte count wraps to zero.
+  Set_header h{};
+  std::memcpy(h.magic, set_magic, sizeof h.magic);
+  h.n = Amir::N;
+  h.k = Amir::K;
+  h.t = Amir::T;
+  h.words = 1;
+  h.size = uint64_t{1} << 61;
+  h.position = Amir::num_combinations;
+  h.width = Amir::N;
+  std::ofstream("test_set_file.bin", std::ios::binary)
+    .write(reinterpret_cast<const char*>(&h), sizeof h);
+  auto bad_size = [](const std::runtime_error& e) {
+    return std::string(e.what()).find("bad size") != std::string::npos;
+  };
+  BOOST_CHECK_EXCEPTION(load_sweep_state<Amir>("test_set_file.bin"), std::runtime_error,
+                        bad_size);
+  std::remove("test_set_file.bin");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,63 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Symmetry
+#include <boost/test/unit_test.hpp>
+#include <set>
+#include "symmetry.h"
+
+typedef Lottery<49, 6, 3> Amir;
+typedef Lottery<80, 7, 3> Wide;
+
+// The original bit-by-bit mirror.
+uint64_t mirror_by_bits(uint64_t x)
+{
+  uint64_t b{0};
+  for (int i = 0; i < 49; ++i) {
+    b <<= 1;
+    b |= (x & 1);
+    x >>= 1;
+  }
+  return b;
+}
+
+BOOST_AUTO_TEST_SUITE(Groups)
+
+BOOST_AUTO_TEST_CASE(Mirror_matches_bit_reversal)
+{
+  Symmetry_group<Amir> g("mirror");
+  BOOST_CHECK_EQUAL(g.order(), 2u);
+  for (auto a : Colex_range<Amir>(0, 100000)) {
+    if (g(0, a) != a || g(1, a) != mirror_by_bits(a))
+      BOOST_FAIL("mirror differs at " << a);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Orders)
+{
+  BOOST_CHECK_EQUAL(Symmetry_group<Amir>("none").order(), 1u);
+  BOOST_CHECK_EQUAL(Symmetry_group<Amir>("cyclic").order(), 49u);
+  BOOST_CHECK_EQUAL(Symmetry_group<Amir>("dihedral").order(), 98u);
+  BOOST_CHECK_EQUAL(Symmetry_group<Amir>("affine").order(), 49u * 42u);
+  BOOST_CHECK_THROW(Symmetry_group<Amir>("tetrahedral"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(Images_are_combinations)
+{
+  Symmetry_group<Amir> g("affine");
+  std::set<uint64_t> images;
+  g.orbit(0b10111011, [&](uint64_t p) {
+    BOOST_CHECK_EQUAL(popcount(p), 6);
+    BOOST_CHECK_EQUAL(p >> 49, 0u);
+    images.insert(p);
+  });
+  // Orbit size divides the group order.
+  BOOST_CHECK_EQUAL(49u * 42u % images.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Cyclic_shift_on_two_words)
+{
+  Symmetry_group<Wide> g("cyclic");
+  uint128_t a = uint128_t{0b1111111} << 73;
+  BOOST_CHECK(g(1, a) == ((uint128_t{0b111111} << 74) | 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,13 +17,66 @@ so let's do it.
 #include <limits>
 #include <iostream>
 #include <iomanip>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
-#include <boost/math/constants/constants.hpp>
+#include <boost/program_options.hpp>
 #include <boost/multiprecision/cpp_dec_float.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
+#ifdef HAVE_GMP
+#include <boost/multiprecision/gmp.hpp>
+#endif
+#ifdef HAVE_MPFR
+#include <boost/multiprecision/mpfr.hpp>
+#endif
 
-typedef boost::multiprecision::cpp_int bigint;
-typedef boost::multiprecision::cpp_dec_float_50 bigfloat;
+namespace bpo = boost::program_options;
+namespace bmp = boost::multiprecision;
+
+/*
+Number backends. A backend gives a big integer type and a
+family of floating types, real<D> with D decimal digits.
+Everything below is written once against a backend B:
+
+  boost   cpp_int and cpp_dec_float, header only
+  gmp     mpz_int and gmp_float, when built with HAVE_GMP
+  mpfr    mpz_int and mpfr_float, when built with HAVE_MPFR
+
+The Makefile turns them on when it finds the headers. GMP
+multiplies huge numbers with asymptotically fast methods
+(Toom-Cook, FFT), cpp_int does not, which is what the
+benchmark mode shows.
+*/
+
+struct Boost_backend {
+  static const char * name() { return "boost"; }
+  typedef bmp::cpp_int integer;
+  template<unsigned Digits> using real = bmp::number<bmp::cpp_dec_float<Digits>>;
+};
+
+#ifdef HAVE_GMP
+struct Gmp_backend {
+  static const char * name() { return "gmp"; }
+  typedef bmp::mpz_int integer;
+  template<unsigned Digits> using real = bmp::number<bmp::gmp_float<Digits>>;
+};
+#endif
+
+#ifdef HAVE_MPFR
+struct Mpfr_backend {
+  static const char * name() { return "mpfr"; }
+  typedef bmp::mpz_int integer;
+  template<unsigned Digits> using real = bmp::number<bmp::mpfr_float_backend<Digits>>;
+};
+#endif
 
 /* 
 Want to find n^k by doing only O(log2 k) multiplications.
@@ -61,108 +114,744 @@ T fast_expt(const T & n, int k) {
   return result;
 }
 
-bigfloat nthroot(const bigfloat & A, int n, const bigfloat & epsilon) {
-  bigfloat x{1};
-  bigfloat D;
-  do {
-    D = (A/fast_expt(x, n-1) - x)/n;
-    x += D;
-  } while (abs(D) > epsilon);
-  return x;
+/*
+Newton's method for x^n = A:
+
+  x -> x - (x^n - A)/(n x^(n-1)) = ((n-1) x + A/x^(n-1))/n
+
+about doubles the number of correct digits at every step, so
+there is no point carrying all the digits from the start.
+Root<D> works with D digits. It gets the root to about D/2
+digits from Root<D/2 + guard>, then does a single Newton step
+at D digits. At the bottom a double precision estimate from
+logarithms starts things off:
+
+  log2(x) = log2(A)/n = k + f,  x = 2^f * 2^k
+
+with k a whole number, so x never has to fit in a double,
+even when A is far out of double range (f(2047) is about
+10^427). Each level costs about half as much as the one above
+it, so the whole root costs a few Newton steps at full
+precision, however many digits are asked for.
+*/
+
+const unsigned guard_digits = 5;
+const unsigned seed_digits = 24;
+
+template<typename T>
+T newton_step(const T & A, const T & x, int n) {
+  return ((n - 1) * x + A / fast_expt(x, n - 1)) / n;
+}
+
+template<typename B, unsigned Digits, bool seed = (Digits <= seed_digits)> struct Root;
+
+template<typename B, unsigned Digits> struct Root<B, Digits, true> {
+  typedef typename B::template real<Digits> real;
+  static real solve(const real & A, int n) {
+    int e;
+    double m = frexp(A, &e).template convert_to<double>();
+    double y = (std::log2(m) + e) / n;
+    double k = std::floor(y);
+    real x = ldexp(real(std::exp2(y - k)), int(k));
+    return newton_step(A, x, n);
+  }
+};
+
+template<typename B, unsigned Digits> struct Root<B, Digits, false> {
+  typedef typename B::template real<Digits> real;
+  static const unsigned half = Digits / 2 + guard_digits;
+  static real solve(const real & A, int n) {
+    real x{Root<B, half>::solve(typename B::template real<half>(A), n)};
+    return newton_step(A, x, n);
+  }
+};
+
+template<typename B, unsigned Digits>
+typename B::template real<Digits> nthroot(const typename B::template real<Digits> & A, int n) {
+  return Root<B, Digits>::solve(A, n);
 }
 
 /*
-Matrix method for generating Fibonacci numbers.
+Fast doubling for Fibonacci numbers. From f(n) and f(n+1):
 
-[ 1 1 ]^n   = [a b] = [f(n+1) f(n)  ]
-[ 1 0 ]       [c d]   [f(n)   f(n-1)]
+  f(2n)   = f(n) (2 f(n+1) - f(n))
+  f(2n+1) = f(n)^2 + f(n+1)^2
+  f(n+2)  = f(n) + f(n+1)
 
-[a b][a b] = [a^2 + bc  ac + dc ]  
-[c d][c d]   [ab + bd   bc + d^2]
+That is three multiplications per doubling where the 2x2
+matrix product takes eight. f(m) for any m comes from
+walking the bits of m from the top: double, and step when
+the bit is 1. Lucas numbers come for free:
 
-[1 1] [a b] = [a + c  b + d]
-[1 0] [c d]   [a      b    ]
+  L(n) = 2 f(n+1) - f(n)
 
+The products go into scratch numbers that live as long as
+the Fibonacci object does, so their limbs are allocated once
+and reused at every step instead of building temporaries.
 */
 
-class Fmatrix
+template<typename Integer> class Fibonacci
 {
 public:
-int n{1}; // keeps track of itself.
-  bigint a{1};
-  bigint b{1};
-  bigint c{1};
-  bigint d{0};
-  // Since we will use fast exponentiation,
-  // all we need is *= operator.
-  Fmatrix & operator*=(const Fmatrix& rhs)
+  int n{1};
+  Integer f{1}; // f(n)
+  Integer g{1}; // f(n+1)
+  // n -> 2n.
+  void twice()
+  {
+    t = g;
+    t <<= 1;
+    t -= f;
+    multiply(u, f, t);
+    multiply(t, f, f);
+    multiply(f, g, g);
+    add(g, t, f);
+    f.swap(u);
+    n *= 2;
+  }
+  // n -> n + 1.
+  void step()
+  {
+    f += g;
+    f.swap(g);
+    n += 1;
+  }
+  // n -> m, from scratch.
+  void seek(int m)
+  {
+    n = 0; f = 0; g = 1;
+    int bit = 1;
+    while (bit <= m / 2) bit *= 2;
+    for (; bit > 0; bit /= 2) {
+      twice();
+      if (m & bit) step();
+    }
+  }
+  void lucas(Integer & result) const
   {
-    bigint new_a, new_b, new_c, new_d;
-    new_a = a*rhs.a + b*rhs.c;
-    new_b = a*rhs.b + b*rhs.d;
-    new_c = c*rhs.a + d*rhs.c;
-    new_d = c*rhs.b + d*rhs.d;
-    a = new_a; b = new_b; c = new_c; d = new_d; n += rhs.n;
-    return *this;
+    result = g;
+    result <<= 1;
+    result -= f;
   }
+private:
+  Integer t;
+  Integer u;
 };
 
-std::ostream& operator<<(std::ostream& out, const Fmatrix& f)
+/*
+Any linear recurrence
+
+  a(n) = c(1) a(n-1) + c(2) a(n-2) + ... + c(D) a(n-D)
+
+steps its last D values with the companion matrix M:
+
+  [a(n+D)  ]   [c(1) c(2) ... c(D)] [a(n+D-1)]
+  [a(n+D-1)] = [ 1    0   ...  0  ] [a(n+D-2)]
+  [  ...   ]   [ ...              ] [  ...   ]
+  [a(n+1)  ]   [ 0   ...   1   0  ] [a(n)    ]
+
+Recurrence keeps P = M^n, so row D-1 of P against the first
+D values gives a(n), and row D-2 gives a(n+1). It moves like
+Fibonacci does: twice() squares P, step() multiplies it by M,
+which is only a new top row since M shifts the others down.
+D is a template parameter so the loops have fixed bounds the
+compiler can unroll. Products land in a scratch matrix and a
+scratch number kept with the object, and squaring swaps the
+scratch matrix in instead of copying it.
+
+  Pell        2, 1      a(n) = 2 a(n-1) + a(n-2)
+  tribonacci  1, 1, 1   a(n) = a(n-1) + a(n-2) + a(n-3)
+  Padovan     0, 1, 1   a(n) = a(n-2) + a(n-3)
+*/
+
+template<typename Integer, int D> class Recurrence
+{
+public:
+  // initial holds a(0), ..., a(D-1).
+  Recurrence(const std::array<long, D> & coefficients, const std::array<long, D> & initial);
+  int n{0};
+  Integer f; // a(n)
+  Integer g; // a(n+1)
+  void twice();
+  void step();
+  void seek(int m);
+private:
+  typedef std::array<Integer, D * D> Matrix;
+  void update();
+  std::array<long, D> c;
+  std::array<long, D> first;
+  Matrix p;
+  Matrix q;
+  Integer t;
+};
+
+template<typename Integer, int D>
+Recurrence<Integer, D>::Recurrence(const std::array<long, D> & coefficients,
+				   const std::array<long, D> & initial)
+  : c(coefficients)
 {
-  return out << std::endl 
-	     << "n = " << f.n << std::endl 
-	     << f.a << "  " << f.b << std::endl 
-	     << f.c << "  " << f.d << std::endl;
+  // State vectors hold the newest value on top.
+  for (int i = 0; i < D; ++i)
+    first[i] = initial[D - 1 - i];
+  seek(0);
+}
+
+// a(n) and a(n+1) from P.
+template<typename Integer, int D> void Recurrence<Integer, D>::update() {
+  f = 0;
+  g = 0;
+  for (int j = 0; j < D; ++j) {
+    f += p[(D - 1) * D + j] * first[j];
+    if (D > 1) g += p[(D - 2) * D + j] * first[j];
+  }
+  if (D == 1) g = f * c[0];
+}
+
+// n -> 2n.
+template<typename Integer, int D> void Recurrence<Integer, D>::twice() {
+  for (int i = 0; i < D; ++i)
+    for (int j = 0; j < D; ++j) {
+      Integer & x = q[i * D + j];
+      multiply(x, p[i * D], p[j]);
+      for (int k = 1; k < D; ++k) {
+	multiply(t, p[i * D + k], p[k * D + j]);
+	x += t;
+      }
+    }
+  p.swap(q);
+  n *= 2;
+  update();
+}
+
+// n -> n + 1.
+template<typename Integer, int D> void Recurrence<Integer, D>::step() {
+  for (int j = 0; j < D; ++j) {
+    Integer & x = q[j];
+    x = 0;
+    for (int k = 0; k < D; ++k)
+      if (c[k] != 0)
+	x += p[k * D + j] * c[k];
+  }
+  for (int i = D - 1; i > 0; --i)
+    for (int j = 0; j < D; ++j)
+      p[i * D + j].swap(p[(i - 1) * D + j]);
+  for (int j = 0; j < D; ++j)
+    p[j].swap(q[j]);
+  n += 1;
+  update();
+}
+
+// n -> m, from scratch.
+template<typename Integer, int D> void Recurrence<Integer, D>::seek(int m) {
+  for (int i = 0; i < D; ++i)
+    for (int j = 0; j < D; ++j)
+      p[i * D + j] = i == j;
+  n = 0;
+  int bit = 1;
+  while (bit <= m / 2) bit *= 2;
+  for (; m > 0 && bit > 0; bit /= 2) {
+    twice();
+    if (m & bit) step();
+  }
+  update();
+}
+
+/*
+Converting all of a huge integer to a real is wasted work,
+only its leading digits survive. Keep a few more bits than
+the real holds, and put the rest back as a power of 2.
+*/
+
+template<typename Real, typename Integer>
+Real to_real(const Integer & x) {
+  const int keep = std::numeric_limits<Real>::digits + 64;
+  int shift = x > 0 ? int(msb(x)) - keep : 0;
+  if (shift <= 0) return Real(x);
+  return ldexp(Real(Integer(x >> shift)), shift);
 }
 
 /*
-Here's how to get maximum bigfloat precision displayed:
-std::cout.precision(std::numeric_limits<bigfloat>::digits10);
+Here's how to get maximum precision displayed:
+std::cout.precision(std::numeric_limits<real>::digits10);
 */
 
-int main(){
+/*
+Table rows run from n = from to n = to, adding by each time,
+or doubling when by is 0. The Fibonacci numbers are made
+first, one row after the other, since each row starts from
+the one before. Reduced to reals they are small, and the
+roots and ratios of all rows are then worked out by a pool
+of threads, each taking the next row from a shared counter.
+The table is printed in row order when they are done.
+*/
+
+struct Table_range {
+  int from{2};
+  int to{2048};
+  int by{0};
+};
+
+std::vector<int> table_rows(const Table_range & range) {
+  if (range.from < 1 || range.to < range.from || range.by < 0)
+    throw std::runtime_error("bad table range");
+  std::vector<int> rows;
+  for (long n = range.from; n <= range.to; n = range.by > 0 ? n + range.by : 2 * n)
+    rows.push_back(n);
+  return rows;
+}
+
+// Calls f(i) for i = 0, 1, ..., count - 1 on num_threads threads.
+template<typename F> void parallel_for(std::size_t count, int num_threads, F f) {
+  std::atomic<std::size_t> next{0};
+  auto work = [&]() {
+    for (std::size_t i; (i = next++) < count; )
+      f(i);
+  };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < num_threads; ++t)
+    workers.emplace_back(work);
+  for (auto & w : workers)
+    w.join();
+}
+
+// seq is a Fibonacci or a Recurrence, a is its name in the
+// headers.
+template<typename B, typename Sequence>
+void print_table(Sequence & seq, const std::string & a, const Table_range & range,
+		 int num_threads) {
+  typedef typename B::template real<50> real;
+  typedef typename B::integer Integer;
+  struct Row {
+    int n;
+    bool zero;
+    real fa, fb, phi1, phi2;
+  };
+  std::vector<Row> rows;
+
+  for (int n : table_rows(range)) {
+    if (n == 2 * seq.n)
+      seq.twice();
+    else if (n - seq.n > 0 && n - seq.n <= 64)
+      while (seq.n < n) seq.step();
+    else
+      seq.seek(n);
+    rows.push_back(Row{n, seq.f == 0,
+	  to_real<real>(Integer(abs(seq.g))), to_real<real>(Integer(abs(seq.f))), 0, 0});
+  }
+  parallel_for(rows.size(), num_threads, [&](std::size_t i) {
+      if (rows[i].zero) return;
+      rows[i].phi1 = rows[i].fa / rows[i].fb;
+      rows[i].phi2 = nthroot<B, 50>(rows[i].fb, rows[i].n);
+    });
+
+  int width = std::max<int>(5, std::to_string(range.to).size());
   // Table headers.
   std::cout << std::endl
-	    << std::setw(5)
+	    << std::setw(width)
 	    << "n"
 	    << std::setw(30)
-	    << "phi1 = f(n+1)/f(n)"
+	    << "phi1 = " + a + "(n+1)/" + a + "(n)"
 	    << std::setw(30) 
-	    << "phi2 = nthroot(f(n))" << std::endl;
-  std::cout << std::setw(5)
-	    << std::string(5,'-')
+	    << "phi2 = nthroot(" + a + "(n))" << std::endl;
+  std::cout << std::setw(width)
+	    << std::string(width,'-')
 	    << std::setw(30)
 	    << std::string(30,'-')
 	    << std::setw(30) 
 	    << std::string(30,'-') << std::endl;
 
-  // Body of table.
-  Fmatrix f;
-  Fmatrix power_factor;
-  int k = 2047; // limit - 1 because result f starts off at power 1 not 0.
-  int r;
-  while (k > 0) 
+  // Body of table. Ratios and roots are of absolute values,
+  // and undefined where a(n) is 0.
+  for (auto & row : rows)
     {
-      r = k % 2;
-      k = k / 2;
-      if (r == 1) {
-	f *= power_factor;
-	bigfloat fa = bigfloat(f.a);
-	bigfloat fb = bigfloat(f.b);
-	bigfloat phi1 = fa/fb;
-	bigfloat phi2 = nthroot(fb, f.n, 0.00000001);
-	std::cout << std::setw(5)
-		  << f.n 
-		  << std::setw(30)
-		  << std::right << std::setprecision(16) << phi1 
+      std::cout << std::setw(width) << row.n << std::setw(30) << std::right;
+      if (row.zero)
+	std::cout << "-" << std::setw(30) << "-" << std::endl;
+      else
+	std::cout << std::setprecision(16) << row.phi1
 		  << std::setw(30)
-		  << std::right << std::setprecision(16) << phi2 
+		  << std::right << std::setprecision(16) << row.phi2
 		  << std::endl; 	
-      }
-      power_factor *= power_factor;
     }
 }
 
+template<typename B> void print_fibonacci_table(const Table_range & range, int num_threads) {
+  Fibonacci<typename B::integer> f;
+  print_table<B>(f, "f", range, num_threads);
+}
+
+/*
+Recurrences come from the command line as coefficients and,
+after a colon, a(0), ..., a(D-1):
+
+  2,1      Pell numbers 0, 1, 2, 5, 12, ...
+  0,1,1:1,1,1  Padovan numbers 1, 1, 1, 2, 2, 3, ...
+
+Without initial values the sequence starts 0, ..., 0, 1.
+*/
+
+const int max_order = 8;
+
+struct Recurrence_spec {
+  std::vector<long> coefficients;
+  std::vector<long> initial;
+};
+
+std::vector<long> parse_numbers(const std::string & text) {
+  std::vector<long> result;
+  std::size_t start = 0;
+  while (start <= text.size()) {
+    std::size_t end = std::min(text.find(',', start), text.size());
+    std::size_t used = 0;
+    std::string item = text.substr(start, end - start);
+    long x = 0;
+    try { x = std::stol(item, &used); } catch (const std::exception &) {}
+    if (item.empty() || used != item.size())
+      throw std::runtime_error("not a list of whole numbers: " + text);
+    result.push_back(x);
+    start = end + 1;
+  }
+  return result;
+}
+
+Recurrence_spec parse_recurrence(const std::string & text) {
+  Recurrence_spec spec;
+  std::size_t colon = text.find(':');
+  spec.coefficients = parse_numbers(text.substr(0, colon));
+  int order = spec.coefficients.size();
+  if (order > max_order)
+    throw std::runtime_error("at most " + std::to_string(max_order) + " terms: " + text);
+  if (spec.coefficients.back() == 0)
+    throw std::runtime_error("last coefficient is 0: " + text);
+  if (colon == std::string::npos) {
+    spec.initial.assign(order, 0);
+    spec.initial.back() = 1;
+  }
+  else
+    spec.initial = parse_numbers(text.substr(colon + 1));
+  if (int(spec.initial.size()) != order)
+    throw std::runtime_error("need " + std::to_string(order) + " initial values: " + text);
+  return spec;
+}
+
+template<typename B, int D>
+void print_recurrence_table(const Recurrence_spec & spec, const Table_range & range,
+			    int num_threads) {
+  std::array<long, D> c, initial;
+  std::copy(spec.coefficients.begin(), spec.coefficients.end(), c.begin());
+  std::copy(spec.initial.begin(), spec.initial.end(), initial.begin());
+
+  std::cout << std::endl << "a(n) =";
+  bool first = true;
+  for (int j = 0; j < D; ++j)
+    if (c[j] != 0) {
+      if (!first || c[j] < 0)
+	std::cout << " " << (c[j] < 0 ? "-" : "+");
+      std::cout << " " << std::abs(c[j]) << " a(n-" << j + 1 << ")";
+      first = false;
+    }
+  std::cout << ", a(0.." << D - 1 << ") =";
+  for (long x : initial)
+    std::cout << " " << x;
+  std::cout << std::endl;
+
+  Recurrence<typename B::integer, D> a(c, initial);
+  print_table<B>(a, "a", range, num_threads);
+}
+
+template<typename B>
+void print_recurrence_table(const Recurrence_spec & spec, const Table_range & range,
+			    int num_threads) {
+  switch (spec.coefficients.size()) {
+  case 1: print_recurrence_table<B, 1>(spec, range, num_threads); break;
+  case 2: print_recurrence_table<B, 2>(spec, range, num_threads); break;
+  case 3: print_recurrence_table<B, 3>(spec, range, num_threads); break;
+  case 4: print_recurrence_table<B, 4>(spec, range, num_threads); break;
+  case 5: print_recurrence_table<B, 5>(spec, range, num_threads); break;
+  case 6: print_recurrence_table<B, 6>(spec, range, num_threads); break;
+  case 7: print_recurrence_table<B, 7>(spec, range, num_threads); break;
+  case 8: print_recurrence_table<B, 8>(spec, range, num_threads); break;
+  }
+}
+
+// The Fibonacci table, or one table per recurrence.
+template<typename B>
+void print_tables(const std::vector<std::string> & recurrences, const Table_range & range,
+		  int num_threads) {
+  std::vector<Recurrence_spec> specs;
+  for (auto & r : recurrences)
+    specs.push_back(parse_recurrence(r));
+  if (specs.empty())
+    print_fibonacci_table<B>(range, num_threads);
+  for (auto & spec : specs)
+    print_recurrence_table<B>(spec, range, num_threads);
+}
+
+/*
+Benchmark mode. Times f(n) for growing n, and the root of
+f(n) for growing precision, once with every backend built
+in, so they can be compared side by side.
+*/
+
+template<typename F> double seconds(F f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+template<typename B> double time_fibonacci(int n) {
+  Fibonacci<typename B::integer> f;
+  return seconds([&]() { f.seek(n); });
+}
+
+template<typename B, unsigned Digits> double time_root(int n) {
+  typedef typename B::template real<Digits> real;
+  Fibonacci<typename B::integer> f;
+  f.seek(n);
+  real A = to_real<real>(f.f);
+  return seconds([&]() { nthroot<B, Digits>(A, n); });
+}
+
+struct Bench_row {
+  std::string label;
+  std::vector<double> times;
+};
+
+// One column per backend.
+template<typename F> void bench_row(std::vector<Bench_row> & rows, const std::string & label, F f) {
+  Bench_row row{label, {f(Boost_backend())}};
+#ifdef HAVE_GMP
+  row.times.push_back(f(Gmp_backend()));
+#endif
+#ifdef HAVE_MPFR
+  row.times.push_back(f(Mpfr_backend()));
+#endif
+  rows.push_back(row);
+}
+
+template<unsigned Digits> void bench_root(std::vector<Bench_row> & rows, int n) {
+  bench_row(rows, "root " + std::to_string(Digits) + " digits",
+	    [n](auto b) { return time_root<decltype(b), Digits>(n); });
+}
+
+void run_bench(int max_n) {
+  std::vector<std::string> names{Boost_backend::name()};
+#ifdef HAVE_GMP
+  names.push_back(Gmp_backend::name());
+#endif
+#ifdef HAVE_MPFR
+  names.push_back(Mpfr_backend::name());
+#endif
+
+  std::vector<Bench_row> rows;
+  // long long, so the last n * 10 cannot overflow.
+  for (long long n = 1000; n <= max_n; n *= 10)
+    bench_row(rows, "f(" + std::to_string(n) + ")",
+	      [n](auto b) { return time_fibonacci<decltype(b)>(int(n)); });
+  bench_root<50>(rows, 100000);
+  bench_root<500>(rows, 100000);
+  bench_root<5000>(rows, 100000);
+  bench_root<10000>(rows, 100000);
+
+  std::cout << std::endl << std::setw(20) << "seconds";
+  for (auto & name : names)
+    std::cout << std::setw(12) << name;
+  std::cout << std::endl << std::setw(20) << std::string(20,'-');
+  for (std::size_t i = 0; i < names.size(); ++i)
+    std::cout << std::setw(12) << std::string(10,'-');
+  std::cout << std::endl;
+  for (auto & row : rows) {
+    std::cout << std::setw(20) << row.label;
+    for (double t : row.times)
+      std::cout << std::setw(12) << std::fixed << std::setprecision(4) << t;
+    std::cout << std::endl;
+  }
+}
+
+/*
+High precision mode. phi to D decimals is
+
+  phi 10^D = (10^D + sqrt(5 10^2D)) / 2
+
+rounded down, one integer square root. isqrt does Newton's
+method with precision doubling, like nthroot: the root of N
+comes from the root of N with its low half of bits dropped,
+shifted back up and given one Newton step r -> (r + N/r)/2,
+which leaves it off by a unit or so, put right at the end.
+The ratio f(n+1)/f(n) to D decimals is one division.
 
+Printing a million digit number with str() is quadratic.
+Decimal_writer splits it in two with one division by 10^h,
+h half the digits, and prints the high half then the low
+half, so digits stream out as they are found and the big
+divisions go to the backend's fast multiplication. Powers
+of 10 are kept; each level of the split needs one or two.
+*/
+
+template<typename Integer> Integer isqrt(const Integer & N) {
+  if (N < 2) return N;
+  int bits = msb(N) + 1;
+  if (bits <= 52) {
+    Integer r = Integer(std::sqrt(N.template convert_to<double>()));
+    while (r * r > N) --r;
+    while ((r + 1) * (r + 1) <= N) ++r;
+    return r;
+  }
+  int k = bits / 4;
+  Integer r = isqrt(Integer(N >> (2 * k))) << k;
+  r += N / r;
+  r >>= 1;
+  while (r * r > N) --r;
+  while ((r + 1) * (r + 1) <= N) ++r;
+  return r;
+}
 
+template<typename Integer> class Decimal_writer
+{
+public:
+  explicit Decimal_writer(std::ostream & out) : out(out) {}
+  // x < 10^width, printed with exactly width digits.
+  void write(const Integer & x, long width);
+  const Integer & power_of_ten(long k);
+private:
+  static const long small = 1000;
+  std::ostream & out;
+  std::map<long, Integer> powers;
+};
 
+template<typename Integer> const Integer & Decimal_writer<Integer>::power_of_ten(long k) {
+  auto it = powers.find(k);
+  if (it == powers.end())
+    it = powers.emplace(k, pow(Integer(10), unsigned(k))).first;
+  return it->second;
+}
+
+template<typename Integer> void Decimal_writer<Integer>::write(const Integer & x, long width) {
+  if (width <= small) {
+    std::string digits = x.str();
+    out << std::string(width - digits.size(), '0') << digits;
+    return;
+  }
+  long low = width / 2;
+  Integer q, r;
+  divide_qr(x, power_of_ten(low), q, r);
+  write(q, width - low);
+  write(r, low);
+}
+
+// Prints x / 10^decimals with all its decimals, and times
+// the computation and the printing on standard error.
+template<typename Integer>
+void print_decimals(Decimal_writer<Integer> & writer, std::ostream & out, const Integer & x,
+		    long decimals, double compute) {
+  double print = seconds([&]() {
+      Integer q, r;
+      divide_qr(x, writer.power_of_ten(decimals), q, r);
+      out << q << ".";
+      writer.write(r, decimals);
+      out << std::endl;
+    });
+  std::cerr << decimals << " decimals, " << compute << " s to compute, "
+	    << print << " s to print, "
+	    << decimals / (compute + print) << " decimals/s" << std::endl;
+}
+
+// phi, or f(n+1)/f(n) when n > 0, to decimals places.
+template<typename B> void print_digits(long decimals, int n) {
+  typedef typename B::integer Integer;
+  Decimal_writer<Integer> writer(std::cout);
+  Integer x;
+  double compute = seconds([&]() {
+      const Integer & p = writer.power_of_ten(decimals);
+      if (n > 0) {
+	Fibonacci<Integer> f;
+	f.seek(n);
+	x = f.g * p / f.f;
+      }
+      else
+	x = (p + isqrt(Integer(5 * p * p))) / 2;
+    });
+  print_decimals(writer, std::cout, x, decimals, compute);
+}
+
+int main(int argc, char ** argv) {
+  std::string backend;
+  int bench = 0;
+  long digits = 0;
+  int ratio = 0;
+  Table_range range;
+  std::vector<std::string> recurrences;
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bpo::options_description options("Options");
+  options.add_options()
+    ("help,h", "this message")
+    ("backend,b", bpo::value<std::string>(&backend)->default_value(
+#ifdef HAVE_GMP
+      "gmp"
+#else
+      "boost"
+#endif
+      ), "boost | gmp | mpfr (built with make MPFR=yes)")
+    ("recurrence,r", bpo::value<std::vector<std::string>>(&recurrences)->composing(),
+     "coefficients[:initial values] of a recurrence to tabulate instead of f(n), "
+     "for example 2,1 or 0,1,1:1,1,1; may be repeated")
+    ("from", bpo::value<int>(&range.from)->default_value(range.from), "first row n")
+    ("to", bpo::value<int>(&range.to)->default_value(range.to), "last row n at most")
+    ("by", bpo::value<int>(&range.by)->default_value(range.by),
+     "step between rows, 0 doubles n")
+    ("threads,t", bpo::value<int>(&num_threads)->default_value(num_threads),
+     "threads working out the rows")
+    ("bench", bpo::value<int>(&bench)->implicit_value(10000000),
+     "compare the backends, f(n) up to this n")
+    ("digits,d", bpo::value<long>(&digits), "print phi to this many decimals")
+    ("ratio", bpo::value<int>(&ratio),
+     "with --digits, print f(n+1)/f(n) for this n instead of phi");
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::parse_command_line(argc, argv, options), vm);
+    bpo::notify(vm);
+  }
+  catch (const std::exception & e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (vm.count("help")) {
+    std::cout << options << std::endl;
+    return 0;
+  }
+
+  if (digits < 0 || ratio < 0 || (ratio > 0 && digits == 0)) {
+    std::cerr << "--digits must be positive, and --ratio needs it" << std::endl;
+    return 1;
+  }
+  if (num_threads < 1) {
+    std::cerr << "need at least one thread" << std::endl;
+    return 1;
+  }
+
+  try {
+    if (bench > 0)
+      run_bench(bench);
+    else if (backend == "boost")
+      digits > 0 ? print_digits<Boost_backend>(digits, ratio)
+	: print_tables<Boost_backend>(recurrences, range, num_threads);
+#ifdef HAVE_GMP
+    else if (backend == "gmp")
+      digits > 0 ? print_digits<Gmp_backend>(digits, ratio)
+	: print_tables<Gmp_backend>(recurrences, range, num_threads);
+#endif
+#ifdef HAVE_MPFR
+    else if (backend == "mpfr")
+      digits > 0 ? print_digits<Mpfr_backend>(digits, ratio)
+	: print_tables<Mpfr_backend>(recurrences, range, num_threads);
+#endif
+    else
+      throw std::runtime_error("backend not built in: " + backend);
+  }
+  catch (const std::exception & e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -25,17 +25,38 @@ inserting them into a heap.
 It must be noted that this heap is totally ordered by <.
 No element can be equal to another.
 
-Max uint64_t is 18446744073709551616. We can handle all
-numbers in A037992 presented above.
+Max uint64_t is 18446744073709551616, enough for all the
+numbers in A037992 presented above but not the next one. The
+products are kept factored, and multiplied out with big
+integers only when asked.
 
 */
 
 #include <iostream>
 #include <iomanip>
 #include <vector>
-#include <bitset>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
 #include <cstdint> // uint64_t
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <queue>
+#include <unordered_map>
+#include <stdexcept>
+#include <random>
+
+#include <boost/program_options.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+#ifdef HAVE_GMP
+#include <boost/multiprecision/gmp.hpp>
+#endif
+
+namespace bpo = boost::program_options;
 
 // Reference sequence. Smallest numbers with 2^N divisors.
 const std::vector<uint64_t> A037992{1, 2, 6, 24, 120, 840, 7560, 
@@ -211,7 +232,7 @@ void Prime_heap::pop(Prime_power & top)
 	break;
       } else {
 	heap[k] = heap[left];
-	k = left;
+	heap[left] = temp;
 	break;
       }
     }
@@ -232,38 +253,366 @@ void Prime_heap::pop(Prime_power & top)
 
 /*
 
-Prime sieve using bit vector of size N.
+Heap<T, Compare, Arity>.
+
+The same hole-moving heap as Prime_heap, for any T, as a
+d-ary tree: node i has children Arity*i + 1 ... Arity*i + Arity.
+A wider tree is shallower, and the children of a node are
+compared side by side in memory. Compare(a, b) says a comes
+out before b, so the default std::less gives the smallest
+first, like Prime_heap.
+
+The storage is aligned to 64 bytes and the root sits at slot
+Arity - 1, which puts every family of Arity children at the
+start of a cache line. With 4 children of 16 bytes, as for
+Prime_power, each family is exactly one line.
+
+Elements are only ever moved: push and pop carry one element
+in hand and move the others into the hole as it travels.
+Building from a range sifts down the parents from the last
+one up, in linear time.
 
 */
 
-template<int N> struct Prime_sieve
+template<typename T, std::size_t Alignment> struct Aligned_allocator
 {
-  std::bitset<N> sieve;
-  std::vector<int> primes;
-  void build(void);
+  typedef T value_type;
+  template<typename U> struct rebind { typedef Aligned_allocator<U, Alignment> other; };
+  Aligned_allocator() = default;
+  template<typename U> Aligned_allocator(const Aligned_allocator<U, Alignment> &) {}
+  T * allocate(std::size_t n)
+  {
+    void * p = nullptr;
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+      throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+  void deallocate(T * p, std::size_t) { free(p); }
 };
 
-template<int N> void Prime_sieve<N>::build(void)
+template<typename T, typename U, std::size_t A>
+bool operator==(const Aligned_allocator<T, A> &, const Aligned_allocator<U, A> &) { return true; }
+template<typename T, typename U, std::size_t A>
+bool operator!=(const Aligned_allocator<T, A> &, const Aligned_allocator<U, A> &) { return false; }
+
+template<typename T, typename Compare = std::less<T>, int Arity = 4> class Heap
 {
-  for (int i = 0; i < sieve.size(); ++i)
-    sieve.set(i);
-  sieve.reset(0);
-  sieve.reset(1);
-  for (int p = 2; p < sieve.size(); ++p)
-    if (sieve[p])
-      for (int k = 2; k*p < sieve.size(); ++k)
-	sieve.reset(k*p);
+public:
+  explicit Heap(const Compare & compare = Compare()) : before(compare)
+  {
+    slots.resize(offset);
+  }
+  template<typename It> Heap(It first, It last, const Compare & compare = Compare());
+  bool empty() const { return size() == 0; }
+  std::size_t size() const { return slots.size() - offset; }
+  void reserve(std::size_t n) { slots.reserve(n + offset); }
+  // Assumes heap is not empty.
+  const T & top() const { return slots[offset]; }
+  void push(T x);
+  void pop(T & top);
+private:
+  static_assert(Arity >= 2, "a heap needs at least two children per node");
+  static const std::size_t offset = Arity - 1;
+  // The elements, root first. The loops below work through
+  // this pointer rather than the vector, so the compiler
+  // need not reload the vector's own pointer after each move.
+  T * heap() { return slots.data() + offset; }
+  void sift_down(std::size_t hole, T x);
+  void sift_up(std::size_t hole, T x);
+  std::size_t best_child(const T * heap, std::size_t first, std::size_t n) const;
+  std::vector<T, Aligned_allocator<T, 64>> slots;
+  Compare before;
+};
 
-  for (int i = 0; i < sieve.size(); ++i)
-    if (sieve[i])
-      primes.push_back(i);
+template<typename T, typename Compare, int Arity>
+const std::size_t Heap<T, Compare, Arity>::offset;
+
+template<typename T, typename Compare, int Arity>
+template<typename It>
+Heap<T, Compare, Arity>::Heap(It first, It last, const Compare & compare)
+  : before(compare)
+{
+  slots.resize(offset);
+  slots.insert(slots.end(), first, last);
+  std::size_t n = size();
+  for (std::size_t i = n > 1 ? (n - 2) / Arity + 1 : 0; i-- > 0; ) {
+    T x = std::move(heap()[i]);
+    sift_down(i, std::move(x));
+  }
 }
 
-template<int N> std::ostream & operator<<(std::ostream & out, Prime_sieve<N> & p)
+template<typename T, typename Compare, int Arity>
+void Heap<T, Compare, Arity>::push(T x)
 {
-  for (auto u : p.primes)
-    out << u << " ";
-  return out;
+  slots.emplace_back();
+  sift_up(size() - 1, std::move(x));
+}
+
+// Moves the hole up from k past the parents that x comes
+// before, then drops x into it.
+template<typename T, typename Compare, int Arity>
+void Heap<T, Compare, Arity>::sift_up(std::size_t k, T x)
+{
+  T * h = heap();
+  while (k > 0) {
+    std::size_t parent = (k - 1) / Arity;
+    if (!before(x, h[parent]))
+      break;
+    h[k] = std::move(h[parent]);
+    k = parent;
+  }
+  h[k] = std::move(x);
+}
+
+// The child that comes first in the family starting at first.
+template<typename T, typename Compare, int Arity>
+std::size_t Heap<T, Compare, Arity>::best_child(const T * h, std::size_t first,
+						std::size_t n) const
+{
+  std::size_t best = first;
+  std::size_t last = std::min<std::size_t>(first + Arity, n);
+  for (std::size_t c = first + 1; c < last; ++c)
+    if (before(h[c], h[best]))
+      best = c;
+  return best;
+}
+
+// Moves the hole down from hole past the children that come
+// before x, then drops x into it.
+template<typename T, typename Compare, int Arity>
+void Heap<T, Compare, Arity>::sift_down(std::size_t hole, T x)
+{
+  T * h = heap();
+  std::size_t n = size();
+  for (std::size_t first; (first = Arity * hole + 1) < n; ) {
+    std::size_t best = best_child(h, first, n);
+    if (!before(h[best], x))
+      break;
+    h[hole] = std::move(h[best]);
+    hole = best;
+  }
+  h[hole] = std::move(x);
+}
+
+// Assumes heap is not empty. The last element nearly always
+// belongs near the bottom again, so the hole goes all the way
+// down first, along the children that come first, and x is
+// moved up from there. That saves comparing x at every level.
+template<typename T, typename Compare, int Arity>
+void Heap<T, Compare, Arity>::pop(T & top)
+{
+  T * h = heap();
+  top = std::move(h[0]);
+  T x = std::move(slots.back());
+  slots.pop_back();
+  std::size_t n = size();
+  if (n == 0)
+    return;
+  std::size_t hole = 0;
+  for (std::size_t first; (first = Arity * hole + 1) < n; ) {
+    std::size_t best = best_child(h, first, n);
+    h[hole] = std::move(h[best]);
+    hole = best;
+  }
+  sift_up(hole, std::move(x));
+}
+
+/*
+
+Segmented prime sieve.
+
+Sieving all of [0, limit) at once needs limit bits and does
+not fit in cache long before 10^10. Instead the numbers are
+sieved one segment at a time, 32 KiB of bits so a segment
+stays in L1. Only odd numbers are kept: bit i of a segment
+starting at odd lo stands for lo + 2i, which halves memory
+and work. Each prime p crosses off its odd multiples from
+p^2 on, the smaller ones being done by smaller primes.
+
+The primes up to sqrt of the segment's end are needed. They
+are sieved the same way, segment by segment, with the base
+primes found so far: the next stretch of base primes ends at
+most at the square of where the last one did, so the primes
+that sieve it are all there already. Segments are sieved in batches, one
+batch of segments per thread at a time, and their primes
+handed out in order by next(). Memory stays at a batch of
+segments and their primes, however far the stream goes.
+
+*/
+
+class Prime_stream
+{
+public:
+  // Primes below limit, sieved on num_threads threads.
+  explicit Prime_stream(uint64_t limit = max_limit, int num_threads = 1);
+  // The next prime, or 0 once past the limit.
+  uint64_t next();
+  static const uint64_t max_limit = uint64_t(1) << 62;
+private:
+  static const uint64_t segment_words = 4096; // 32 KiB.
+  static const uint64_t segment_span = 128 * segment_words;
+  static const int segments_per_thread = 8;
+  void extend_base(uint64_t hi);
+  void sieve_segment(uint64_t lo, uint64_t hi, std::vector<uint64_t> & bits,
+		     std::vector<uint64_t> & primes) const;
+  void sieve_batch();
+  uint64_t limit;
+  int num_threads;
+  uint64_t low{1};                   // Next segment starts here.
+  std::vector<uint32_t> base{};      // Odd primes below base_end.
+  uint64_t base_end{3};
+  std::vector<std::vector<uint64_t>> batch;
+  std::size_t segment{0};
+  std::size_t index{0};
+  bool two{true};
+};
+
+const uint64_t Prime_stream::max_limit;
+const uint64_t Prime_stream::segment_words;
+const uint64_t Prime_stream::segment_span;
+const int Prime_stream::segments_per_thread;
+
+Prime_stream::Prime_stream(uint64_t limit, int num_threads)
+  : limit(std::min(limit, max_limit)), num_threads(std::max(1, num_threads))
+{
+}
+
+// Odd primes up to at least sqrt(hi).
+void Prime_stream::extend_base(uint64_t hi)
+{
+  uint64_t need = std::sqrt(double(hi)) + 1;
+  std::vector<uint64_t> bits;
+  std::vector<uint64_t> primes;
+  while (base_end <= need) {
+    uint64_t end = std::min(std::max(2 * base_end, need + 1), base_end * base_end) | 1;
+    bits.resize(segment_words);
+    for (uint64_t lo = base_end; lo < end; lo += segment_span) {
+      sieve_segment(lo, std::min(lo + segment_span, end), bits, primes);
+      base.insert(base.end(), primes.begin(), primes.end());
+    }
+    base_end = end;
+  }
+}
+
+// Primes in [lo, hi), lo odd and hi at most a segment on.
+void Prime_stream::sieve_segment(uint64_t lo, uint64_t hi, std::vector<uint64_t> & bits,
+				 std::vector<uint64_t> & primes) const
+{
+  std::fill(bits.begin(), bits.end(), ~uint64_t(0));
+  for (uint64_t p : base) {
+    if (p * p >= hi)
+      break;
+    uint64_t m = std::max(p * p, (lo + p - 1) / p * p);
+    if (m % 2 == 0)
+      m += p;
+    for (uint64_t i = (m - lo) / 2; i < segment_span / 2; i += p)
+      bits[i / 64] &= ~(uint64_t(1) << (i % 64));
+  }
+  primes.clear();
+  for (uint64_t w = 0; w < segment_words; ++w)
+    for (uint64_t b = bits[w]; b != 0; b &= b - 1) {
+      uint64_t n = lo + 2 * (64 * w + __builtin_ctzll(b));
+      if (n >= hi)
+	return;
+      if (n > 1)
+	primes.push_back(n);
+    }
+}
+
+void Prime_stream::sieve_batch()
+{
+  std::size_t count = std::size_t(num_threads) * segments_per_thread;
+  uint64_t left = (limit - low + segment_span - 1) / segment_span;
+  count = std::min<uint64_t>(count, left);
+  extend_base(std::min(low + count * segment_span, limit));
+  batch.resize(count);
+
+  std::atomic<std::size_t> next_segment{0};
+  auto work = [&]() {
+    std::vector<uint64_t> bits(segment_words);
+    for (std::size_t i; (i = next_segment++) < count; )
+      sieve_segment(low + i * segment_span, std::min(low + (i + 1) * segment_span, limit),
+		    bits, batch[i]);
+  };
+  std::vector<std::thread> workers;
+  for (int t = 1; t < num_threads; ++t)
+    workers.emplace_back(work);
+  work();
+  for (auto & w : workers)
+    w.join();
+
+  low += count * segment_span;
+  segment = 0;
+  index = 0;
+}
+
+uint64_t Prime_stream::next()
+{
+  if (two) {
+    two = false;
+    return limit > 2 ? 2 : 0;
+  }
+  while (segment == batch.size() || index == batch[segment].size()) {
+    if (segment < batch.size()) {
+      ++segment;
+      index = 0;
+      continue;
+    }
+    if (low >= limit)
+      return 0;
+    sieve_batch();
+  }
+  return batch[segment][index++];
+}
+
+/*
+
+Prime powers p^2^k in increasing order, made lazily.
+
+There is no need to put every p^2^k below some limit in the
+heap up front. p^2^(k+1) can only come out after p^2^k, so it
+is pushed when p^2^k is popped. Likewise the next prime can
+only come out after the newest one in the heap, and is taken
+from a Prime_stream when that one is popped. The heap then
+holds about one power per prime used so far, and the
+sequence runs on as far as anyone cares to pop.
+
+Powers too big to square in a uint64_t are not followed up:
+their squares are past 2^64, beyond every term we can hold.
+
+*/
+
+class Prime_powers
+{
+public:
+  explicit Prime_powers(int num_threads = 1);
+  Prime_power next();
+  std::size_t heap_size() const { return heap.size(); }
+private:
+  Prime_stream primes;
+  Heap<Prime_power> heap;
+  uint64_t newest;
+};
+
+Prime_powers::Prime_powers(int num_threads)
+  : primes(uint64_t(1) << 32, num_threads), newest(primes.next())
+{
+  heap.push(Prime_power(newest, 0));
+}
+
+Prime_power Prime_powers::next()
+{
+  Prime_power top;
+  heap.pop(top);
+  if (top.exponent == 1 && top.prime == newest) {
+    newest = primes.next();
+    if (newest == 0)
+      throw std::runtime_error("out of 32-bit primes");
+    heap.push(Prime_power(newest, 0));
+  }
+  if (top.value <= UINT32_MAX)
+    heap.push(Prime_power(top.prime, __builtin_ctz(top.exponent) + 1));
+  return top;
 }
 
 /*
@@ -271,23 +620,56 @@ template<int N> std::ostream & operator<<(std::ostream & out, Prime_sieve<N> & p
 Products of the first N pops of the heap are accumulated here
 and printed out nicely.
 
-To do: merge prime powers with the same bases.
+The product soon outgrows any machine integer, so it is kept
+factored: one entry per prime, with the exponents of its
+powers added up. p^2^k comes out after p^2^(k-1), so a prime
+that has been popped k+1 times has exponent 2^(k+1) - 1. A
+hash map finds a prime's entry. The size of the product is
+kept too, as a base 2 logarithm, which gives its number of
+digits without working it out.
+
+The exact value is only worked out when asked for, as a
+product tree: the factors p^e are multiplied in pairs, then
+the pairs in pairs, and so on, so the big multiplications
+are between numbers of about the same size, where GMP's fast
+methods pay off.
+
+There is no need for logarithms to order the prime powers
+themselves. The ones that come out of the heap are all below
+2^64, and compared exactly as uint64_t values.
 
 */
+
+#ifdef HAVE_GMP
+typedef boost::multiprecision::mpz_int bigint;
+#else
+typedef boost::multiprecision::cpp_int bigint;
+#endif
+
 struct Minimal_accumulator
 {
   std::vector<uint64_t> prime;
   std::vector<uint64_t> exponent;
-  uint64_t value{1};
+  std::unordered_map<uint64_t, std::size_t> index;
+  double log2_value{0};
   void insert(const Prime_power & pk);
   std::string to_string() const;
+  // Number of decimal digits.
+  uint64_t digits() const { return uint64_t(log2_value * std::log10(2.0)) + 1; }
+  bigint value() const;
 };
 
 void Minimal_accumulator::insert(const Prime_power & pk)
 {
-  prime.push_back(pk.prime);
-  exponent.push_back(pk.exponent);
-  value *= pk.value;
+  auto it = index.find(pk.prime);
+  if (it == index.end()) {
+    index.emplace(pk.prime, prime.size());
+    prime.push_back(pk.prime);
+    exponent.push_back(pk.exponent);
+  }
+  else
+    exponent[it->second] += pk.exponent;
+  log2_value += pk.exponent * std::log2(double(pk.prime));
 }
 
 std::string Minimal_accumulator::to_string() const
@@ -303,36 +685,306 @@ std::string Minimal_accumulator::to_string() const
   return out.str();
 }
 
-int main()
+bigint Minimal_accumulator::value() const
+{
+  std::vector<bigint> level;
+  for (std::size_t i = 0; i < prime.size(); ++i)
+    level.push_back(pow(bigint(prime[i]), unsigned(exponent[i])));
+  if (level.empty())
+    return 1;
+  while (level.size() > 1) {
+    std::vector<bigint> next((level.size() + 1) / 2);
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2)
+      multiply(next[i / 2], level[i], level[i + 1]);
+    if (level.size() % 2)
+      next.back().swap(level.back());
+    level.swap(next);
+  }
+  return level[0];
+}
+
+/*
+
+A037992 far out. The product of the first n terms has 2^n
+divisors, the product of e + 1 over its exponents, so each
+e + 1 has to be a power of 2 and their logarithms have to add
+up to n. That is checked, as are the published values above,
+and, when the exact value is asked for, its number of digits
+against the logarithm.
+
+*/
+
+void run_a037992(std::size_t n, int num_threads, bool print_value)
+{
+  auto start = std::chrono::steady_clock::now();
+  Prime_powers powers(num_threads);
+  Minimal_accumulator ma;
+  bigint exact = 1;
+  std::size_t checked = 0;
+  for (std::size_t i = 1; i <= n; ++i) {
+    Prime_power pk = powers.next();
+    ma.insert(pk);
+    if (i < A037992.size()) {
+      exact *= pk.value;
+      if (exact != A037992[i])
+	throw std::runtime_error("differs from A037992 at " + std::to_string(i));
+      checked = i;
+    }
+  }
+  std::chrono::duration<double> compute = std::chrono::steady_clock::now() - start;
+
+  uint64_t divisor_bits = 0;
+  for (auto e : ma.exponent) {
+    if ((e + 1) & e)
+      throw std::runtime_error("an exponent plus 1 is not a power of 2");
+    divisor_bits += __builtin_ctzll(e + 1);
+  }
+  if (divisor_bits != n)
+    throw std::runtime_error("wrong number of divisors");
+
+  std::cout << "a(" << n << ") = " << (n <= 50 ? ma.to_string() : "...") << std::endl
+	    << "  " << ma.prime.size() << " primes, largest " << ma.prime.back()
+	    << ", exponent of 2 is " << ma.exponent[0] << std::endl
+	    << "  " << ma.digits() << " digits, log10 = "
+	    << std::setprecision(12) << ma.log2_value * std::log10(2.0) << std::endl
+	    << "  2^" << n << " divisors, equal to A037992 up to a(" << checked << ")" << std::endl
+	    << "  " << compute.count() << " s to compute" << std::endl;
+
+  if (print_value) {
+    start = std::chrono::steady_clock::now();
+    std::string digits = ma.value().str();
+    std::chrono::duration<double> tree = std::chrono::steady_clock::now() - start;
+    if (std::abs(double(digits.size()) - double(ma.digits())) > 1)
+      throw std::runtime_error("exact value and logarithm disagree");
+    std::cout << "  " << tree.count() << " s for the product tree and its digits" << std::endl
+	      << digits << std::endl;
+  }
+}
+
+/*
+
+Heap benchmark. n prime powers p^2^k, all of those below some
+prime, in random order, are pushed into each heap and popped
+out again. The pops have to come out in increasing order.
+
+*/
+
+std::vector<Prime_power> heap_workload(std::size_t n, int num_threads)
+{
+  std::vector<uint32_t> primes;
+  Prime_stream stream(Prime_stream::max_limit, num_threads);
+  while (primes.size() < n)
+    primes.push_back(stream.next());
+  Prime_power limit(primes.back(), 0);
+  std::vector<Prime_power> work;
+  for (auto p : primes)
+    for (int k = 0; k < 6 && Prime_power(p, k) < limit; ++k)
+      work.push_back(Prime_power(p, k));
+  std::mt19937_64 random(1);
+  std::shuffle(work.begin(), work.end(), random);
+  work.resize(n);
+  return work;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+// fill puts the workload into a heap, drain pops it all out
+// through the given function.
+template<typename Fill, typename Drain>
+void bench_heap(const std::string & name, const std::vector<Prime_power> & work,
+		Fill fill, Drain drain)
+{
+  auto start = std::chrono::steady_clock::now();
+  fill(work);
+  double fill_time = seconds_since(start);
+  start = std::chrono::steady_clock::now();
+  uint64_t previous = 0;
+  bool sorted = true;
+  std::size_t count = 0;
+  drain([&](const Prime_power & x) {
+      sorted = sorted && previous < x.value;
+      previous = x.value;
+      ++count;
+    });
+  double drain_time = seconds_since(start);
+  std::cout << std::setw(24) << name
+	    << std::setw(12) << std::fixed << std::setprecision(3) << fill_time
+	    << std::setw(12) << drain_time
+	    << std::setw(12) << fill_time + drain_time
+	    << std::setw(8) << (sorted && count == work.size() ? "ok" : "WRONG")
+	    << std::endl;
+}
+
+template<int Arity> void bench_d_ary(const std::vector<Prime_power> & work)
+{
+  Heap<Prime_power, std::less<Prime_power>, Arity> h;
+  auto drain = [&](std::function<void(const Prime_power &)> f) {
+    Prime_power x;
+    while (!h.empty()) { h.pop(x); f(x); }
+  };
+  bench_heap("Heap, " + std::to_string(Arity) + "-ary", work,
+	     [&](const std::vector<Prime_power> & w) {
+	       h.reserve(w.size());
+	       for (auto & x : w) h.push(x);
+	     }, drain);
+  bench_heap("Heap, " + std::to_string(Arity) + "-ary, heapify", work,
+	     [&](const std::vector<Prime_power> & w) {
+	       h = Heap<Prime_power, std::less<Prime_power>, Arity>(w.begin(), w.end());
+	     }, drain);
+}
+
+void run_heap_bench(std::size_t n, int num_threads)
+{
+  std::vector<Prime_power> work = heap_workload(n, num_threads);
+  std::cout << std::endl << n << " prime powers, seconds" << std::endl << std::endl
+	    << std::setw(24) << "heap" << std::setw(12) << "fill" << std::setw(12) << "pop all"
+	    << std::setw(12) << "total" << std::setw(8) << "order" << std::endl
+	    << std::setw(24) << std::string(22,'=') << std::setw(12) << std::string(10,'=')
+	    << std::setw(12) << std::string(10,'=') << std::setw(12) << std::string(10,'=')
+	    << std::setw(8) << std::string(6,'=') << std::endl;
+
+  Prime_heap ph;
+  bench_heap("Prime_heap", work,
+	     [&](const std::vector<Prime_power> & w) { for (auto & x : w) ph.insert(x); },
+	     [&](std::function<void(const Prime_power &)> f) {
+	       Prime_power x;
+	       while (!ph.empty()) { ph.pop(x); f(x); }
+	     });
+
+  auto later = [](const Prime_power & a, const Prime_power & b) { return b < a; };
+  std::priority_queue<Prime_power, std::vector<Prime_power>, decltype(later)> pq(later);
+  bench_heap("std::priority_queue", work,
+	     [&](const std::vector<Prime_power> & w) { for (auto & x : w) pq.push(x); },
+	     [&](std::function<void(const Prime_power &)> f) {
+	       while (!pq.empty()) { f(pq.top()); pq.pop(); }
+	     });
+
+  bench_d_ary<2>(work);
+  bench_d_ary<4>(work);
+  bench_d_ary<8>(work);
+}
+
+// Counts, or prints, the primes below n.
+void run_primes(uint64_t n, int num_threads, bool print)
+{
+  auto start = std::chrono::steady_clock::now();
+  Prime_stream primes(n, num_threads);
+  uint64_t count = 0;
+  for (uint64_t p; (p = primes.next()) != 0; ++count)
+    if (print)
+      std::cout << p << "\n";
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  if (!print)
+    std::cout << count << " primes below " << n << std::endl;
+  std::cerr << seconds.count() << " s" << std::endl;
+}
+
+// The first n terms of A050376, p^2^k in order.
+void run_sequence(uint64_t n, int num_threads)
+{
+  auto start = std::chrono::steady_clock::now();
+  Prime_powers powers(num_threads);
+  std::size_t largest_heap = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    std::cout << powers.next().value << "\n";
+    largest_heap = std::max(largest_heap, powers.heap_size());
+  }
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  std::cerr << n << " terms, heap of at most " << largest_heap << ", "
+	    << seconds.count() << " s" << std::endl;
+}
+
+int main(int argc, char ** argv)
 { 
-  Prime_sieve<1000> ps;
-  ps.build();
-
-  // The limit for p^2^k is the last prime in the prime sieve.
-  Prime_power limit(ps.primes.back(),0);
-
-  // Populate the prime heap. k is increased until prime^2^k is 
-  // above the limit, then move on to the next prime. 
-  Prime_heap h;
-  int k;
-  for (auto p : ps.primes) {
-    k = 0;
-    while (true) {
-      Prime_power pk(p,k);
-      if (!(pk < limit))
-	break;
-      h.insert(pk);
-      ++k;
+  uint64_t count_primes = 0;
+  uint64_t print_primes = 0;
+  std::size_t bench_heap = 0;
+  uint64_t sequence = 0;
+  std::size_t a037992 = 0;
+  int rows = 17;
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bpo::options_description options("Options");
+  options.add_options()
+    ("help,h", "this message")
+    ("sequence", bpo::value<uint64_t>(&sequence), "print this many terms of A050376")
+    ("rows,n", bpo::value<int>(&rows)->default_value(rows), "rows in the table")
+    ("a037992", bpo::value<std::size_t>(&a037992),
+     "work out the n-th term of A037992, factored, and check it")
+    ("value", "with --a037992, print all its digits too")
+    ("count-primes", bpo::value<uint64_t>(&count_primes), "count the primes below this")
+    ("primes", bpo::value<uint64_t>(&print_primes), "print the primes below this")
+    ("bench-heap", bpo::value<std::size_t>(&bench_heap)->implicit_value(10000000),
+     "time the heaps on this many prime powers")
+    ("threads,t", bpo::value<int>(&num_threads)->default_value(num_threads),
+     "threads sieving primes");
+  bpo::variables_map vm;
+  try {
+    bpo::store(bpo::parse_command_line(argc, argv, options), vm);
+    bpo::notify(vm);
+  }
+  catch (const std::exception & e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (vm.count("help")) {
+    std::cout << options << std::endl;
+    return 0;
+  }
+  if (num_threads < 1) {
+    std::cerr << "need at least one thread" << std::endl;
+    return 1;
+  }
+  if (bench_heap > 0) {
+    run_heap_bench(bench_heap, num_threads);
+    return 0;
+  }
+  if (count_primes > 0 || print_primes > 0) {
+    run_primes(std::max(count_primes, print_primes), num_threads, print_primes > 0);
+    return 0;
+  }
+
+  if (sequence > 0) {
+    run_sequence(sequence, num_threads);
+    return 0;
+  }
+  if (a037992 > 0) {
+    try {
+      run_a037992(a037992, num_threads, vm.count("value"));
+    }
+    catch (const std::exception & e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
     }
+    return 0;
   }
 
+  Prime_powers powers(num_threads);
+
   // Table of form...
   //
   // N  |  product of first N p^2^k  |  value  |  Sloane A037992
   
+  // The rows are worked out first, so the columns can be made
+  // wide enough for the last one. The value is kept up to date
+  // as we go, which is cheap while it is small.
+  Minimal_accumulator ma;
+  bigint value = 1;
+  std::vector<std::string> products, values;
+  for (int N = 1; N <= rows; ++N) {
+    Prime_power temp = powers.next();
+    ma.insert(temp);
+    value *= temp.value;
+    products.push_back(ma.to_string());
+    values.push_back(value.str());
+  }
+
   int N_width = 5;
-  int product_width = 70;
-  int value_width = 25;
+  int product_width = std::max<int>(70, products.back().size() + 2);
+  int value_width = std::max<int>(25, values.back().size() + 2);
 
   // Title
   std::cout << std::endl 
@@ -353,15 +1005,13 @@ int main()
 	    << std::setw(value_width) << std::string(value_width,'=') << std::endl;
 
   // Table body.
-  Minimal_accumulator ma;
-  Prime_power temp; 
-  for (int N = 1; N < 18; ++N) {
-    h.pop(temp);
-    ma.insert(temp);
+  for (int N = 1; N <= rows; ++N) {
     std::cout << std::setw(N_width) << N
-	      << std::setw(product_width) << ma.to_string() 
-	      << std::setw(value_width) << ma.value 
-	      << std::setw(value_width) << A037992[N] << std::endl;
+	      << std::setw(product_width) << products[N - 1]
+	      << std::setw(value_width) << values[N - 1];
+    if (N < int(A037992.size()))
+      std::cout << std::setw(value_width) << A037992[N];
+    std::cout << std::endl;
   }
 
   return 0;